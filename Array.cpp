@@ -38,78 +38,78 @@
 
 #include "formula.h"
 #include "Array.h"
+#include "RNG.h"
+#include "IVSolver.h"
+
+/* Cell I-V models for SolveReadCurrent. The device Read models are ohmic, so I/v is their slope */
+struct AnalogCellIV {
+	Array *array;
+	int x, y;
+	double operator()(double voltage, double *dIdv) {
+		double current = array->AnalogRead(x, y, voltage);
+		*dIdv = current / voltage;
+		return current;
+	}
+};
+
+struct DigitalCellIV {
+	DigitalNVM *device;
+	double operator()(double voltage, double *dIdv) {
+		double current = device->Read(voltage);
+		*dIdv = current / voltage;
+		return current;
+	}
+};
 
 int counter=0;
 double Array::ReadCell(int x, int y, char* mode) {
     // mode is only for the 3T1C cell to select LSB or MSB
     // it should be "MSB_LTP","MSB_LTD" or "LSB" 
-	if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(**cell)){ // Analog eNVM
+	if (IsAnalogNVM()){ // Analog eNVM
 		double readVoltage = static_cast<eNVM*>(cell[x][y])->readVoltage;
-		double totalWireResistance;
-		if (static_cast<eNVM*>(cell[x][y])->cmosAccess){  // 1T1R cell or 1T1C cell
-			if (static_cast<AnalogNVM*>(cell[x][y])->FeFET) // FeFET
-				totalWireResistance = (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol; // do not need to consider the access resistance
-            else // Normal
-				totalWireResistance = (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol + static_cast<eNVM*>(cell[x][y])->resistanceAccess;
-		} 
-        else 
-			totalWireResistance = (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol;
+		double totalWireResistance = this->totalWireResistance[x * arrayRowSize + y];
+		double conductance = compact? cellConductance[x * arrayRowSize + y] : static_cast<eNVM*>(cell[x][y])->conductance;
 		double cellCurrent;
 		if (static_cast<eNVM*>(cell[x][y])->nonlinearIV){
-			// Bisection method to calculate read current with nonlinearity
-			int maxIter = 30;
-			double v1 = 0, v2 = readVoltage, v3;
-			double wireCurrent;
-			for (int iter=0; iter<maxIter; iter++){
-				v3 = (v1 + v2)/2;
-				wireCurrent = (readVoltage - v3)/totalWireResistance;
-				cellCurrent = static_cast<AnalogNVM*>(cell[x][y])->Read(v3);
-				if (wireCurrent > cellCurrent)
-					v1 = v3;
-				else
-					v2 = v3;
-			}
+			AnalogCellIV cellIV = {this, x, y};
+			cellCurrent = SolveReadCurrent(readVoltage, totalWireResistance, cellIV);
 		} 
         else{	// No nonlinearity
 			if (static_cast<eNVM*>(cell[x][y])->readNoise){
-				extern std::mt19937 gen;
-				cellCurrent = readVoltage / (1/static_cast<eNVM*>(cell[x][y])->conductance * (1 + (*static_cast<eNVM*>(cell[x][y])->gaussian_dist)(gen)) + totalWireResistance);
+				cellCurrent = readVoltage / (1/conductance * (1 + static_cast<eNVM*>(cell[x][y])->sigmaReadNoise * RandomNormal(x, y, cell[x][y]->randomStream, RANDOM_READ_NOISE)) + totalWireResistance);
 			} 
             else
-				cellCurrent = readVoltage / (1/static_cast<eNVM*>(cell[x][y])->conductance + totalWireResistance);
+				cellCurrent = readVoltage / (1/conductance + totalWireResistance);
 		}
 		return cellCurrent;
 	} 
-    else if (HybridCell *temp = dynamic_cast<HybridCell*>(**cell)){
+    else if (IsHybridCell()){
         if(mode=="LSB"){
-            extern std::mt19937 gen;
             double readVoltage_LSB =  static_cast<HybridCell*>(cell[x][y])->LSBcell.readVoltage;
             double totalWireResistance_LSB = (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol;
             double cellCurrent_LSB;
             if (static_cast<HybridCell*>(cell[x][y])->LSBcell.readNoise)
-				cellCurrent_LSB = readVoltage_LSB / (1/static_cast<HybridCell*>(cell[x][y])->LSBcell.conductance * (1 + (*static_cast<HybridCell*>(cell[x][y])->LSBcell.gaussian_dist)(gen)) + totalWireResistance_LSB);
+				cellCurrent_LSB = readVoltage_LSB / (1/static_cast<HybridCell*>(cell[x][y])->LSBcell.conductance * (1 + static_cast<HybridCell*>(cell[x][y])->LSBcell.sigmaReadNoise * RandomNormal(x, y, static_cast<HybridCell*>(cell[x][y])->LSBcell.randomStream, RANDOM_READ_NOISE)) + totalWireResistance_LSB);
             else
                 cellCurrent_LSB = readVoltage_LSB / (1/static_cast<HybridCell*>(cell[x][y])->LSBcell.conductance + totalWireResistance_LSB);      
             return cellCurrent_LSB;
         }
         else if(mode=="MSB_LTP"){
-            extern std::mt19937 gen;
             double readVoltage_MSB = static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.readVoltage;
             double totalWireResistance_MSB=  (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol +static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.resistanceAccess;
             double cellCurrent_MSB_LTP;
             if (static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.readNoise) 
-                cellCurrent_MSB_LTP = readVoltage_MSB / (1/static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.conductance * (1 + (*static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.gaussian_dist)(gen)) + totalWireResistance_MSB);
+                cellCurrent_MSB_LTP = readVoltage_MSB / (1/static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.conductance * (1 + static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.sigmaReadNoise * RandomNormal(x, y, static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.randomStream, RANDOM_READ_NOISE)) + totalWireResistance_MSB);
             else
                 cellCurrent_MSB_LTP = readVoltage_MSB / (1/static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP.conductance +  totalWireResistance_MSB);
            return cellCurrent_MSB_LTP;
         }
         else if(mode=="MSB_LTD"){
-            extern std::mt19937 gen;
             double readVoltage_MSB = static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.readVoltage;  
             double totalWireResistance_MSB=  (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol +(static_cast<HybridCell*>(cell[x][y])->MSBcell_LTP).resistanceAccess;
             double cellCurrent_MSB_LTD;          
             if (static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.readNoise) 
-                cellCurrent_MSB_LTD = readVoltage_MSB / (1/static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.conductance * (1 + (*static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.gaussian_dist)(gen)) + totalWireResistance_MSB);
+                cellCurrent_MSB_LTD = readVoltage_MSB / (1/static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.conductance * (1 + static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.sigmaReadNoise * RandomNormal(x, y, static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.randomStream, RANDOM_READ_NOISE)) + totalWireResistance_MSB);
             else
                 cellCurrent_MSB_LTD = readVoltage_MSB / (1/static_cast<HybridCell*>(cell[x][y])->MSBcell_LTD.conductance + totalWireResistance_MSB); 
             return cellCurrent_MSB_LTD;  
@@ -118,7 +118,7 @@ double Array::ReadCell(int x, int y, char* mode) {
     }
     else{ // SRAM or digital eNVM
 		int weightDigits = 0;
-		if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(**cell)) {	// Digital eNVM
+		if (IsDigitalNVM()) {	// Digital eNVM
 			for (int n=0; n<numCellPerSynapse; n++){   // n=0 is LSB
 				int colIndex = (x+1) * numCellPerSynapse - (n+1);
 				double readVoltage = static_cast<eNVM*>(cell[colIndex][y])->readVoltage;
@@ -129,24 +129,12 @@ double Array::ReadCell(int x, int y, char* mode) {
 					totalWireResistance = (colIndex + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol;
 				double cellCurrent;
 				if (static_cast<eNVM*>(cell[colIndex][y])->nonlinearIV) {
-					/* Bisection method to calculate read current with nonlinearity */
-					int maxIter = 30;
-					double v1 = 0, v2 = readVoltage, v3;
-					double wireCurrent;
-					for (int iter=0; iter<maxIter; iter++){
-						v3 = (v1 + v2)/2;
-						wireCurrent = (readVoltage - v3)/totalWireResistance;
-						cellCurrent = static_cast<DigitalNVM*>(cell[colIndex][y])->Read(v3);
-						if (wireCurrent > cellCurrent)
-							v1 = v3;
-						else
-							v2 = v3;
-					}
+					DigitalCellIV cellIV = {static_cast<DigitalNVM*>(cell[colIndex][y])};
+					cellCurrent = SolveReadCurrent(readVoltage, totalWireResistance, cellIV);
 				} 
                 else{ // No nonlinearity 
 					if (static_cast<eNVM*>(cell[colIndex][y])->readNoise){
-						extern std::mt19937 gen;
-						cellCurrent = readVoltage / (1/static_cast<eNVM*>(cell[colIndex][y])->conductance * (1 + (*static_cast<eNVM*>(cell[colIndex][y])->gaussian_dist)(gen)) + totalWireResistance);
+						cellCurrent = readVoltage / (1/static_cast<eNVM*>(cell[colIndex][y])->conductance * (1 + static_cast<eNVM*>(cell[colIndex][y])->sigmaReadNoise * RandomNormal(colIndex, y, cell[colIndex][y]->randomStream, RANDOM_READ_NOISE)) + totalWireResistance);
 					} 
                     else 
 						cellCurrent = readVoltage / (1/static_cast<eNVM*>(cell[colIndex][y])->conductance + totalWireResistance);
@@ -172,22 +160,44 @@ double Array::ReadCell(int x, int y, char* mode) {
 void Array::WriteCell(int x, int y, double deltaWeight, double weight, double maxWeight, double minWeight, 
 						bool regular /* False: ideal write, True: regular write considering device properties */){
 	// TODO: include wire resistance
-	if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(**cell)){ // Analog eNVM
-        if (regular)	// Regular write
-			static_cast<AnalogNVM*>(cell[x][y])->Write(deltaWeight, weight, minWeight, maxWeight);
+	if (IsAnalogNVM()){ // Analog eNVM
+        if (regular && compact) {
+			switch (cellKind) {
+				case IDEAL_DEVICE:	CompactWrite<IdealDevice>(x, y, deltaWeight, weight, maxWeight, minWeight); break;
+				case REAL_DEVICE:	CompactWrite<RealDevice>(x, y, deltaWeight, weight, maxWeight, minWeight); break;
+				default:	CompactWrite<MeasuredDevice>(x, y, deltaWeight, weight, maxWeight, minWeight);
+			}
+		}
+        else if (regular) {	// Regular write (qualified calls skip the virtual dispatch)
+			switch (cellKind) {
+				case IDEAL_DEVICE:	static_cast<IdealDevice*>(cell[x][y])->IdealDevice::Write(deltaWeight, weight, minWeight, maxWeight); break;
+				case REAL_DEVICE:	static_cast<RealDevice*>(cell[x][y])->RealDevice::Write(deltaWeight, weight, minWeight, maxWeight); break;
+				case MEASURED_DEVICE:	static_cast<MeasuredDevice*>(cell[x][y])->MeasuredDevice::Write(deltaWeight, weight, minWeight, maxWeight); break;
+				default:	static_cast<_2T1F*>(cell[x][y])->_2T1F::Write(deltaWeight, weight, minWeight, maxWeight);
+			}
+		}
         else{	
 			double conductance = 0;
 			double maxConductance = static_cast<eNVM*>(cell[x][y])->maxConductance;
 			double minConductance = static_cast<eNVM*>(cell[x][y])->minConductance;
+			if (cellMaxConductance) {
+				maxConductance = cellMaxConductance[x * arrayRowSize + y];
+				minConductance = cellMinConductance[x * arrayRowSize + y];
+			}
 			conductance = (weight-minWeight)/(maxWeight-minWeight) * (maxConductance - minConductance);
 			if (conductance > maxConductance) 
 				conductance = maxConductance; 
             else if (conductance < minConductance) 
 				conductance = minConductance;
-			static_cast<eNVM*>(cell[x][y])->conductance = conductance;
+			if (compact)
+				cellConductance[x * arrayRowSize + y] = conductance;
+			else
+				static_cast<eNVM*>(cell[x][y])->conductance = conductance;
 		}
+		if (cellReadCurrent)
+			UpdateReadCurrent(x, y);
 	}
-    else if(HybridCell*temp = dynamic_cast<HybridCell*>(**cell)){
+    else if(IsHybridCell()){
         double weightLSB = this->ConductanceToWeight(x,y, maxWeight, minWeight, "LSB");
 		
         if (regular) // Regular write
@@ -218,7 +228,7 @@ void Array::WriteCell(int x, int y, double deltaWeight, double weight, double ma
 		else if (targetWeightDigits < 0)
 			targetWeightDigits = 0;		
 		/* Write new weight and calculate write energy */
-		if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(**cell)){ // Digital eNVM
+		if (IsDigitalNVM()){ // Digital eNVM
 			for (int n=0; n<numCellPerSynapse; n++){ // n=0 is LSB
 				int bitNew = ((targetWeightDigits >> n) & 1); //get the nth bit to write to
 				/* Write new weight */
@@ -240,14 +250,25 @@ void Array::WriteCell(int x, int y, double deltaWeight, double weight, double ma
 				static_cast<SRAM*>(cell[(x+1) * numCellPerSynapse - (n+1)][y])->bit = bitNew;	// If the rightmost is LSB
 			}
 		}
+		if (weightPlane)
+			UpdateWeightPlane(x, y);
+	}
+}
+
+double Array::AnalogRead(int x, int y, double voltage) {
+	switch (cellKind) {
+		case IDEAL_DEVICE:	return static_cast<IdealDevice*>(cell[x][y])->IdealDevice::Read(voltage);
+		case REAL_DEVICE:	return static_cast<RealDevice*>(cell[x][y])->RealDevice::Read(voltage);
+		case MEASURED_DEVICE:	return static_cast<MeasuredDevice*>(cell[x][y])->MeasuredDevice::Read(voltage);
+		default:	return static_cast<_2T1F*>(cell[x][y])->_2T1F::Read(voltage);
 	}
 }
 
 double Array::GetMaxCellReadCurrent(int x, int y, char* mode) { 
     // two mode: "LSB", "MSB". For hybrid cell only
-    if(AnalogNVM*temp = dynamic_cast<AnalogNVM*>(**cell)) 
+    if(IsAnalogNVM()) 
 	    return static_cast<AnalogNVM*>(cell[x][y])->GetMaxReadCurrent();
-    else if (HybridCell* temp = dynamic_cast<HybridCell*>(**cell)){   
+    else if (IsHybridCell()){   
         if(mode=="LSB")
             return static_cast<HybridCell*>(cell[x][y])->LSBcell.GetMaxReadCurrent();
         else if(mode =="MSB")
@@ -259,9 +280,9 @@ double Array::GetMaxCellReadCurrent(int x, int y, char* mode) {
 
 double Array::GetMinCellReadCurrent(int x, int y, char*mode) {
     // two mode: "LSB", "MSB". For hybrid cell only
-    if(AnalogNVM*temp = dynamic_cast<AnalogNVM*>(**cell)) 
+    if(IsAnalogNVM()) 
 	    return static_cast<AnalogNVM*>(cell[x][y])->GetMinReadCurrent();
-    else if (HybridCell* temp = dynamic_cast<HybridCell*>(**cell)){   
+    else if (IsHybridCell()){   
         if(mode=="LSB")
             return static_cast<HybridCell*>(cell[x][y])->LSBcell.GetMinReadCurrent();
         else if(mode =="MSB")
@@ -273,11 +294,11 @@ double Array::GetMinCellReadCurrent(int x, int y, char*mode) {
 
 double Array::GetMediumCellReadCurrent(int x, int y) {  
     double Imax, Imin;
-    if(AnalogNVM*temp = dynamic_cast<AnalogNVM*>(**cell)){
+    if(IsAnalogNVM()){
 	     Imax = static_cast<AnalogNVM*>(cell[x][y])->GetMaxReadCurrent();
          Imin = static_cast<AnalogNVM*>(cell[x][y])->GetMinReadCurrent();
     }
-    else if(HybridCell*temp = dynamic_cast<HybridCell*>(**cell)){
+    else if(IsHybridCell()){
              Imax = static_cast<HybridCell*>(cell[x][y])->LSBcell.GetMaxReadCurrent();
 	         Imin = static_cast<HybridCell*>(cell[x][y])->LSBcell.GetMinReadCurrent();
     }
@@ -286,7 +307,7 @@ double Array::GetMediumCellReadCurrent(int x, int y) {
 
 // convert the conductance to -1~1 
 double Array::ConductanceToWeight(int x, int y, double maxWeight, double minWeight, char* mode) {
-	if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(**cell)){	// Analog eNVM
+	if (IsAnalogNVM()){	// Analog eNVM
 		/* Measure current */
 		double I = this->ReadCell(x, y); // for AnalogNVM, read the current and convert it into conductance
 		/* Convert current to weight */
@@ -298,7 +319,7 @@ double Array::ConductanceToWeight(int x, int y, double maxWeight, double minWeig
 			I = Imax;
 		return (I-Imin) / (Imax-Imin) * (maxWeight-minWeight) + minWeight;
 	}
-    else if (HybridCell *temp = dynamic_cast<HybridCell*>(**cell)){
+    else if (IsHybridCell()){
 		double I = this->ReadCell(x, y,"LSB"); // for 3T1C cell, read the current and convert it into conductance
 		double Imax = static_cast<HybridCell*>(cell[x][y])->LSBcell.GetMaxReadCurrent(); // the current when Conductance is the minimum
 		double Imin = static_cast<HybridCell*>(cell[x][y])->LSBcell.GetMinReadCurrent(); // the current when Conductance is the maximum
@@ -349,3 +370,356 @@ double Array::ConductanceToWeight(int x, int y, double maxWeight, double minWeig
 	}
 }
 
+void Array::InitializeWireResistance(int cellsPerRow) {
+	totalWireResistance = new double[cellsPerRow * arrayRowSize];
+	for (int x=0; x<cellsPerRow; x++) {
+		for (int y=0; y<arrayRowSize; y++) {
+			double resistance;
+			if (static_cast<eNVM*>(cell[x][y])->cmosAccess){  // 1T1R cell or 1T1C cell
+				if (static_cast<AnalogNVM*>(cell[x][y])->FeFET) // FeFET
+					resistance = (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol; // do not need to consider the access resistance
+				else // Normal
+					resistance = (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol + static_cast<eNVM*>(cell[x][y])->resistanceAccess;
+			}
+			else
+				resistance = (x + 1) * wireResistanceRow + (arrayRowSize - y) * wireResistanceCol;
+			totalWireResistance[x * arrayRowSize + y] = resistance;
+		}
+	}
+}
+
+/* The sums are accumulated row by row in the same order as the read loops did, so the cached values are bit-identical */
+void Array::UpdateReadReferences(int cellsPerRow) {
+	delete[] columnIsumMax;
+	delete[] columnIsumMin;
+	delete[] mediumCurrentSum;
+	columnIsumMax = new double[cellsPerRow];
+	columnIsumMin = new double[cellsPerRow];
+	bool uniform = true;
+	double mediumCurrent = GetMediumCellReadCurrent(0, 0);
+	for (int x=0; x<cellsPerRow; x++) {
+		double IsumMax = 0, IsumMin = 0;
+		for (int y=0; y<arrayRowSize; y++) {
+			IsumMax += GetMaxCellReadCurrent(x, y);
+			IsumMin += GetMinCellReadCurrent(x, y);
+			if (GetMediumCellReadCurrent(x, y) != mediumCurrent)
+				uniform = false;
+		}
+		columnIsumMax[x] = IsumMax;
+		columnIsumMin[x] = IsumMin;
+	}
+	mediumCurrentSum = NULL;
+	if (uniform) {
+		mediumCurrentSum = new double[arrayRowSize + 1];
+		mediumCurrentSum[0] = 0;
+		for (int n=0; n<arrayRowSize; n++)
+			mediumCurrentSum[n+1] = mediumCurrentSum[n] + mediumCurrent;
+	}
+}
+
+double Array::ReferenceColumnCurrent(int x, const int *rows, int numRows) {
+	if (mediumCurrentSum)
+		return mediumCurrentSum[numRows];
+	double Isum = 0;
+	for (int r=0; r<numRows; r++)
+		Isum += GetMediumCellReadCurrent(x, rows[r]);
+	return Isum;
+}
+
+/* The cached cell currents are added one by one so that the sum is bit-identical to adding ReadCell */
+double Array::ReadColumnCurrent(int x, const int *rows, int numRows) {
+	eNVM *device = static_cast<eNVM*>(cell[x][0]);
+	double Isum = 0;
+	if (!cellReadCurrent || device->readNoise || device->nonlinearIV) {	// Draws random numbers or iterates per cell
+		for (int r=0; r<numRows; r++) {
+			Isum += ReadCell(x, rows[r]);
+		}
+		return Isum;
+	}
+	const double *current = cellReadCurrent + x * arrayRowSize;
+	for (int r=0; r<numRows; r++)
+		Isum += current[rows[r]];
+	return Isum;
+}
+
+void Array::InitializeReadCurrent(int cellsPerRow) {
+	eNVM *device = static_cast<eNVM*>(cell[0][0]);
+	if (device->readNoise || device->nonlinearIV)
+		return;
+	if (posix_memalign((void **)&cellReadCurrent, 64, (size_t)cellsPerRow * arrayRowSize * sizeof(double)) != 0) {
+		puts("Not enough memory for the read currents");
+		exit(-1);
+	}
+	for (int x=0; x<cellsPerRow; x++) {
+		for (int y=0; y<arrayRowSize; y++) {
+			UpdateReadCurrent(x, y);
+		}
+	}
+}
+
+void Array::UpdateReadCurrent(int x, int y) {
+	int i = x * arrayRowSize + y;
+	double conductance = compact? cellConductance[i] : static_cast<eNVM*>(cell[x][y])->conductance;
+	cellReadCurrent[i] = static_cast<eNVM*>(cell[x][y])->readVoltage / (1/conductance + totalWireResistance[i]);
+}
+
+void Array::InitializeWeightPlane() {
+	delete[] weightPlane;
+	weightPlane = NULL;
+	if (IsDigitalNVM() && static_cast<eNVM*>(cell[0][0])->readNoise)	// Every read draws new noise, so the digits cannot be cached
+		return;
+	numPlaneWords = (arrayRowSize + 63) / 64;
+	weightPlane = new unsigned long long[(size_t)arrayColSize * numCellPerSynapse * numPlaneWords]();
+	for (int x=0; x<arrayColSize; x++) {
+		for (int y=0; y<arrayRowSize; y++) {
+			UpdateWeightPlane(x, y);
+		}
+	}
+}
+
+/* Rows of a column share plane words and the weight update writes the rows in parallel, hence the atomics */
+void Array::UpdateWeightPlane(int x, int y) {
+	int weightDigits = (int)ReadCell(x, y);
+	unsigned long long mask = 1ULL << (y%64);
+	for (int n=0; n<numCellPerSynapse; n++) {
+		unsigned long long *word = weightPlane + ((size_t)x * numCellPerSynapse + n) * numPlaneWords + y/64;
+		if ((weightDigits >> n) & 1) {
+			#pragma omp atomic
+			*word |= mask;
+		} else {
+			#pragma omp atomic
+			*word &= ~mask;
+		}
+	}
+}
+
+/* Sum of the digits over the selected rows is the popcount of each weight bit plane ANDed with the row plane, weighted by 2^n */
+int Array::ReadColumnDigits(int x, const int *rows, int numRows, const unsigned long long *rowPlane) {
+	int Dsum = 0;
+	if (!weightPlane) {
+		for (int r=0; r<numRows; r++) {
+			Dsum += (int)(ReadCell(x, rows[r]));
+		}
+		return Dsum;
+	}
+	for (int n=0; n<numCellPerSynapse; n++) {
+		const unsigned long long *plane = weightPlane + ((size_t)x * numCellPerSynapse + n) * numPlaneWords;
+		int count = 0;
+		for (int w=0; w<numPlaneWords; w++) {
+			count += __builtin_popcountll(plane[w] & rowPlane[w]);
+		}
+		Dsum += count << n;
+	}
+	return Dsum;
+}
+
+void Array::InitializeCompact(int cellsPerRow) {
+	AnalogNVM *device = static_cast<AnalogNVM*>(prototype);
+	if (!IsAnalogNVM() || Is2T1F() || device->nonlinearIV || device->nonIdenticalPulse) {
+		puts("[Error] Compact array storage only supports analog eNVM with linear I-V and identical write pulses");
+		exit(-1);
+	}
+	compact = true;
+	Cell **prototypeRow = new Cell*[arrayRowSize];
+	for (int row=0; row<arrayRowSize; row++) {
+		prototypeRow[row] = prototype;
+	}
+	cell = new Cell**[cellsPerRow];
+	for (int col=0; col<cellsPerRow; col++) {
+		cell[col] = prototypeRow;
+	}
+
+	int numCells = cellsPerRow * arrayRowSize;
+	cellConductance = new double[numCells];
+	cellConductancePrev = new double[numCells];
+	cellNumPulse = new int[numCells];
+	for (int i=0; i<numCells; i++) {
+		cellConductance[i] = device->conductance;
+		cellConductancePrev[i] = device->conductancePrev;
+		cellNumPulse[i] = 0;
+	}
+	if (device->conductanceRangeVar) {
+		cellMaxConductance = new double[numCells];
+		cellMinConductance = new double[numCells];
+	}
+	if (cellKind == REAL_DEVICE && static_cast<RealDevice*>(device)->sigmaDtoD) {
+		cellParamALTP = new double[numCells];
+		cellParamALTD = new double[numCells];
+	}
+	if (cellMaxConductance || cellParamALTP) {
+		switch (cellKind) {
+			case IDEAL_DEVICE:	LoadCompactVariation<IdealDevice>(cellsPerRow); break;
+			case REAL_DEVICE:	LoadCompactVariation<RealDevice>(cellsPerRow); break;
+			default:	LoadCompactVariation<MeasuredDevice>(cellsPerRow);
+		}
+	}
+}
+
+/* Device variations are drawn in the cell constructor, so build each cell once and keep only its varied parameters */
+template <class memoryType>
+void Array::LoadCompactVariation(int cellsPerRow) {
+	for (int col=0; col<cellsPerRow; col++) {
+		for (int row=0; row<arrayRowSize; row++) {
+			int i = col * arrayRowSize + row;
+			memoryType *temp = new memoryType(col, row);
+			cellConductance[i] = temp->conductance;
+			cellConductancePrev[i] = temp->conductancePrev;
+			if (cellMaxConductance) {
+				cellMaxConductance[i] = temp->maxConductance;
+				cellMinConductance[i] = temp->minConductance;
+			}
+			StoreCompactParamA(temp, i);
+			delete temp;
+		}
+	}
+}
+
+/* Run the device model on the scratch copy of the prototype of this thread, holding the state of cell (x,y).
+   With identical write pulses and linear I-V, Write and WriteEnergyCalculation only read the fields that LoadCompactCell sets */
+template <class memoryType>
+void Array::CompactWrite(int x, int y, double deltaWeight, double weight, double maxWeight, double minWeight) {
+	memoryType *device = static_cast<memoryType*>(compactScratch[omp_get_thread_num()]);
+	LoadCompactCell(device, x, y);
+	LoadCompactParamA(device, x * arrayRowSize + y);
+	device->memoryType::Write(deltaWeight, weight, minWeight, maxWeight);
+	StoreCompactCell(device, x, y);
+}
+
+template <class memoryType>
+double Array::CompactWriteEnergy(int x, int y, double writeLatencyLTP, double writeLatencyLTD) {
+	memoryType *device = static_cast<memoryType*>(compactScratch[omp_get_thread_num()]);
+	LoadCompactCell(device, x, y);
+	LoadCompactParamA(device, x * arrayRowSize + y);
+	device->writeLatencyLTP = writeLatencyLTP;
+	device->writeLatencyLTD = writeLatencyLTD;
+	device->WriteEnergyCalculation(wireCapCol);
+	return device->writeEnergy;
+}
+
+void Array::LoadCompactCell(AnalogNVM *device, int x, int y) {
+	int i = x * arrayRowSize + y;
+	device->x = x;
+	device->y = y;
+	device->conductance = cellConductance[i];
+	device->conductancePrev = cellConductancePrev[i];
+	device->numPulse = cellNumPulse[i];
+	if (cellMaxConductance) {
+		device->maxConductance = cellMaxConductance[i];
+		device->minConductance = cellMinConductance[i];
+	}
+}
+
+/* Only RealDevice has per-cell nonlinearity parameters, and its paramB follows from paramA and the conductance range */
+void Array::LoadCompactParamA(RealDevice *device, int i) {
+	if (cellParamALTP) {
+		device->paramALTP = cellParamALTP[i];
+		device->paramALTD = cellParamALTD[i];
+	}
+	if (cellParamALTP || cellMaxConductance) {
+		device->UpdateParamB();
+	}
+}
+
+void Array::StoreCompactParamA(RealDevice *device, int i) {
+	if (cellParamALTP) {
+		cellParamALTP[i] = device->paramALTP;
+		cellParamALTD[i] = device->paramALTD;
+	}
+}
+
+void Array::StoreCompactCell(AnalogNVM *device, int x, int y) {
+	int i = x * arrayRowSize + y;
+	cellConductance[i] = device->conductance;
+	cellConductancePrev[i] = device->conductancePrev;
+	cellNumPulse[i] = device->numPulse;
+}
+
+int Array::GetNumPulse(int x, int y) {
+	if (compact)
+		return cellNumPulse[x * arrayRowSize + y];
+	return static_cast<AnalogNVM*>(cell[x][y])->numPulse;
+}
+
+// With identical write pulses the write latency follows from the pulse number, so compact mode does not store it
+double Array::GetWriteLatencyLTP(int x, int y) {
+	if (compact) {
+		int numPulse = cellNumPulse[x * arrayRowSize + y];
+		return (numPulse > 0)? numPulse * static_cast<AnalogNVM*>(prototype)->writePulseWidthLTP : 0;
+	}
+	return static_cast<AnalogNVM*>(cell[x][y])->writeLatencyLTP;
+}
+
+double Array::GetWriteLatencyLTD(int x, int y) {
+	if (compact) {
+		int numPulse = cellNumPulse[x * arrayRowSize + y];
+		return (numPulse > 0)? 0 : -numPulse * static_cast<AnalogNVM*>(prototype)->writePulseWidthLTD;
+	}
+	return static_cast<AnalogNVM*>(cell[x][y])->writeLatencyLTD;
+}
+
+double Array::CellWriteEnergy(int x, int y, double writeLatencyLTP, double writeLatencyLTD) {
+	if (compact) {
+		switch (cellKind) {
+			case IDEAL_DEVICE:	return CompactWriteEnergy<IdealDevice>(x, y, writeLatencyLTP, writeLatencyLTD);
+			case REAL_DEVICE:	return CompactWriteEnergy<RealDevice>(x, y, writeLatencyLTP, writeLatencyLTD);
+			default:	return CompactWriteEnergy<MeasuredDevice>(x, y, writeLatencyLTP, writeLatencyLTD);
+		}
+	}
+	AnalogNVM *device = static_cast<AnalogNVM*>(cell[x][y]);
+	device->writeLatencyLTP = writeLatencyLTP;
+	device->writeLatencyLTD = writeLatencyLTD;
+	device->WriteEnergyCalculation(wireCapCol);
+	return device->writeEnergy;
+}
+
+/* Energy counters and cell state of a checkpoint. After a load the read caches are rebuilt from the loaded cells */
+void Array::StreamState(FILE *fp, bool load) {
+	StreamValue(fp, load, readEnergy);
+	StreamValue(fp, load, writeEnergy);
+	StreamValue(fp, load, transferReadEnergy);
+	StreamValue(fp, load, transferWriteEnergy);
+	StreamValue(fp, load, transferEnergy);
+
+	int cellsPerRow = arrayColSize * numCellPerSynapse + 2;	// Initialization always adds the two reference columns
+	size_t numCells = (size_t)cellsPerRow * arrayRowSize;
+	if (compact) {
+		StreamArray(fp, load, cellConductance, numCells);
+		StreamArray(fp, load, cellConductancePrev, numCells);
+		StreamArray(fp, load, cellNumPulse, numCells);
+		if (cellMaxConductance) {
+			StreamArray(fp, load, cellMaxConductance, numCells);
+			StreamArray(fp, load, cellMinConductance, numCells);
+		}
+		if (cellParamALTP) {
+			StreamArray(fp, load, cellParamALTP, numCells);
+			StreamArray(fp, load, cellParamALTD, numCells);
+		}
+		prototype->StreamState(fp, load);
+	} else {
+		for (int x=0; x<cellsPerRow; x++) {
+			for (int y=0; y<arrayRowSize; y++) {
+				cell[x][y]->StreamState(fp, load);
+			}
+		}
+	}
+	if (!load)
+		return;
+
+	if (IsAnalogNVM()) {
+		if (cellReadCurrent) {
+			for (int x=0; x<cellsPerRow; x++) {
+				for (int y=0; y<arrayRowSize; y++) {
+					UpdateReadCurrent(x, y);
+				}
+			}
+		}
+		UpdateReadReferences(cellsPerRow);
+	}
+	if (weightPlane) {
+		for (int x=0; x<arrayColSize; x++) {
+			for (int y=0; y<arrayRowSize; y++) {
+				UpdateWeightPlane(x, y);
+			}
+		}
+	}
+}
@@ -40,11 +40,35 @@
 #define ARRAY_H_
 
 #include <cstdlib>
+#include <vector>
+#include <omp.h>
 #include "Cell.h"
 
+/* Device type of an array, fixed at Initialization so that the kernels can dispatch on it instead of using dynamic_cast */
+enum CellKind
+{
+	IDEAL_DEVICE,
+	REAL_DEVICE,
+	MEASURED_DEVICE,
+	_2T1F_CELL,		/* Last analog eNVM kind */
+	DIGITAL_NVM,
+	SRAM_CELL,
+	HYBRID_CELL
+};
+
+template <class memoryType> struct CellKindOf;
+template <> struct CellKindOf<IdealDevice> { static const CellKind kind = IDEAL_DEVICE; };
+template <> struct CellKindOf<RealDevice> { static const CellKind kind = REAL_DEVICE; };
+template <> struct CellKindOf<MeasuredDevice> { static const CellKind kind = MEASURED_DEVICE; };
+template <> struct CellKindOf<_2T1F> { static const CellKind kind = _2T1F_CELL; };
+template <> struct CellKindOf<DigitalNVM> { static const CellKind kind = DIGITAL_NVM; };
+template <> struct CellKindOf<SRAM> { static const CellKind kind = SRAM_CELL; };
+template <> struct CellKindOf<HybridCell> { static const CellKind kind = HYBRID_CELL; };
+
 class Array {
 public:
 	Cell ***cell;
+	CellKind cellKind;	// Device type of all the cells
 	int arrayColSize, arrayRowSize, wireWidth;
 	double unitLengthWireResistance;
 	double wireResistanceRow, wireResistanceCol;
@@ -58,6 +82,25 @@ public:
 	double writeEnergySRAMCell;	// Write energy per SRAM cell (will move this to SRAM cell level in the future)
 	bool **weightChange;	// Specify if the weight value will change or not during weight update (for SRAM and digital eNVM)
     int refColumnNumber;
+	/* Compact storage (analog eNVM only): the dynamic cell state lives in the per-field arrays below, indexed by x*arrayRowSize+y,
+	   and every cell[x][y] points to one prototype cell that holds the device parameters shared by the whole array */
+	bool compact;
+	Cell *prototype;
+	double *cellConductance;	// Current conductance (S) of each cell
+	double *cellConductancePrev;	// Previous conductance (S) of each cell
+	int *cellNumPulse;	// Number of write pulses used in the most recent write operation of each cell
+	double *cellMaxConductance, *cellMinConductance;	// Per-cell conductance range (NULL unless conductanceRangeVar)
+	double *cellParamALTP, *cellParamALTD;	// Per-cell RealDevice nonlinearity parameters (NULL unless sigmaDtoD)
+	std::vector<Cell*> compactScratch;	// One copy of the prototype per OpenMP thread, into which a compact write loads the state of its cell
+	double *totalWireResistance;	// Analog eNVM only: wire (and access transistor) resistance seen by cell (x,y), at [x*arrayRowSize+y]
+	double *cellReadCurrent;	// Analog eNVM without read noise and I-V nonlinearity: ReadCell(x,y) at [x*arrayRowSize+y], kept current by WriteCell (NULL otherwise)
+	/* Analog eNVM read references, fixed by the device parameters (see UpdateReadReferences) */
+	double *columnIsumMax, *columnIsumMin;	// Sum of GetMax/MinCellReadCurrent over all rows of each column
+	double *mediumCurrentSum;	// [n] = sum of GetMediumCellReadCurrent over n rows if all cells have the same medium current, else NULL
+	/* SRAM and digital eNVM: packed bit planes of the weight digits that ReadCell returns. Bit y of
+	   weightPlane[(x*numCellPerSynapse+n)*numPlaneWords + y/64] is bit n (n=0 is LSB) of synapse (x,y). NULL if the read is noisy */
+	unsigned long long *weightPlane;
+	int numPlaneWords;
 	/* Constructor */
     // code modified
 	Array(int arrayColSize, int arrayRowSize, int wireWidth) {  
@@ -68,6 +111,18 @@ public:
 		writeEnergy = 0;
         transferReadEnergy = transferWriteEnergy = 0;
         transferEnergy = 0;
+		compact = false;
+		prototype = NULL;
+		cellConductance = cellConductancePrev = NULL;
+		cellNumPulse = NULL;
+		cellMaxConductance = cellMinConductance = NULL;
+		cellParamALTP = cellParamALTD = NULL;
+		totalWireResistance = NULL;
+		cellReadCurrent = NULL;
+		columnIsumMax = columnIsumMin = NULL;
+		mediumCurrentSum = NULL;
+		weightPlane = NULL;
+		numPlaneWords = 0;
 
 		/* Initialize weightChange */
 		weightChange = new bool*[arrayColSize];
@@ -77,9 +132,10 @@ public:
 	}
 
 	template <class memoryType>
-	void Initialization(int numCellPerSynapse=1,bool refColumn = false) { // default value is 1
+	void Initialization(int numCellPerSynapse=1,bool refColumn = false, bool compact = false) { // default value is 1
 		/* Determine number of cells per synapse (SRAM and DigitalNVM) */
 		this->numCellPerSynapse = numCellPerSynapse;
+		cellKind = CellKindOf<memoryType>::kind;
 
 		/* Initialize memory cells */
         int cellsPerRow; // the number of columns 
@@ -87,18 +143,26 @@ public:
             cellsPerRow = arrayColSize*numCellPerSynapse+2;
         else
             cellsPerRow = arrayColSize*numCellPerSynapse;
-        cell = new Cell**[cellsPerRow];
-		for (int col=0; col<cellsPerRow; col++) {
-			cell[col] = new Cell*[arrayRowSize];
-			for (int row=0; row<arrayRowSize; row++) {
-				cell[col][row] = new memoryType(col, row);
+        if (compact) {
+			prototype = new memoryType(0, 0);
+			InitializeCompact(cellsPerRow);
+			for (int t=0; t<omp_get_max_threads(); t++) {
+				compactScratch.push_back(new memoryType(*static_cast<memoryType*>(prototype)));
+			}
+		} else {
+			cell = new Cell**[cellsPerRow];
+			for (int col=0; col<cellsPerRow; col++) {
+				cell[col] = new Cell*[arrayRowSize];
+				for (int row=0; row<arrayRowSize; row++) {
+					cell[col][row] = new memoryType(col, row);
+				}
 			}
 		}
         // initialize the conductance of the reference column
         if(refColumn = true)
         {
             refColumnNumber = arrayColSize*numCellPerSynapse; // the column number of the first reference column
-            if(DigitalNVM *temp = dynamic_cast<DigitalNVM*>(this->cell[0][0]))
+            if(IsDigitalNVM())
             {
                 for(int row=0; row < this-> arrayRowSize; row++)
                 {
@@ -136,15 +200,55 @@ public:
 		wireCapRow = wireLength * 0.2e-15/1e-6;
 		wireCapCol = wireLength * 0.2e-15/1e-6;
 		wireGateCapRow = wireLength * 0.2e-15/1e-6;
-		
+		if (IsAnalogNVM()) {
+			InitializeWireResistance(cellsPerRow);
+			InitializeReadCurrent(cellsPerRow);
+			UpdateReadReferences(cellsPerRow);
+		}
+		if (IsSRAM() || IsDigitalNVM())
+			InitializeWeightPlane();
 	}
 
+	void InitializeCompact(int cellsPerRow);
+	void InitializeWireResistance(int cellsPerRow);
+	void InitializeReadCurrent(int cellsPerRow);
+	void UpdateReadCurrent(int x, int y);	// Call after the conductance of cell (x,y) changes outside WriteCell
+	void UpdateReadReferences(int cellsPerRow);	// Call again whenever the device parameters of the cells change
+	void InitializeWeightPlane();
+	void UpdateWeightPlane(int x, int y);
+	template <class memoryType> void LoadCompactVariation(int cellsPerRow);
+	template <class memoryType> void CompactWrite(int x, int y, double deltaWeight, double weight, double maxWeight, double minWeight);
+	template <class memoryType> double CompactWriteEnergy(int x, int y, double writeLatencyLTP, double writeLatencyLTD);
+	void LoadCompactCell(AnalogNVM *device, int x, int y);
+	void StoreCompactCell(AnalogNVM *device, int x, int y);
+	void LoadCompactParamA(RealDevice *device, int i);
+	void LoadCompactParamA(AnalogNVM *, int) {}	// Other analog devices have no per-cell nonlinearity
+	void StoreCompactParamA(RealDevice *device, int i);
+	void StoreCompactParamA(AnalogNVM *, int) {}
+
+	bool IsAnalogNVM() const { return cellKind <= _2T1F_CELL; }
+	bool IsDigitalNVM() const { return cellKind == DIGITAL_NVM; }
+	bool IseNVM() const { return cellKind <= DIGITAL_NVM; }
+	bool IsSRAM() const { return cellKind == SRAM_CELL; }
+	bool IsHybridCell() const { return cellKind == HYBRID_CELL; }
+	bool Is2T1F() const { return cellKind == _2T1F_CELL; }
+
 	double ReadCell(int x, int y,char*mode=NULL);	// x (column) and y (row) start from index 0
+	double AnalogRead(int x, int y, double voltage);	// Device read model of an analog eNVM cell (for the nonlinear I-V solver)
+	double ReadColumnCurrent(int x, const int *rows, int numRows);	// Analog eNVM: sum of ReadCell(x, rows[r]) over r, in the same order
+	int ReadColumnDigits(int x, const int *rows, int numRows, const unsigned long long *rowPlane);	// SRAM and digital eNVM: sum of ReadCell(x, rows[r]) over r, rowPlane is the packed bitset of the same rows
 	void WriteCell(int x, int y, double deltaWeight, double weight, double maxWeight, double minWeight, bool regular);
 	double GetMaxCellReadCurrent(int x, int y, char*mode=NULL);
 	double GetMinCellReadCurrent(int x, int y, char*mode=NULL);
 	double GetMediumCellReadCurrent(int x, int y);
+	double ReferenceColumnCurrent(int x, const int *rows, int numRows);	// Analog eNVM: sum of GetMediumCellReadCurrent(x, rows[r]) over r, in the same order
 	double ConductanceToWeight(int x, int y, double maxWeight, double minWeight,char* mode=NULL);
+	/* Analog eNVM write state of cell (x,y) in either storage mode */
+	int GetNumPulse(int x, int y);
+	double GetWriteLatencyLTP(int x, int y);
+	double GetWriteLatencyLTD(int x, int y);
+	double CellWriteEnergy(int x, int y, double writeLatencyLTP, double writeLatencyLTD);	// Write energy with the batch write latencies
+	void StreamState(FILE *fp, bool load);	// Write (load=false) or read (load=true) the array part of a checkpoint
 };
 
 #endif
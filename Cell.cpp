@@ -39,10 +39,15 @@
 #include <ctime>
 #include <iostream>
 #include <math.h>
+#include <string>
 #include "formula.h"
 #include "Array.h"
 #include "Cell.h"
+#include "RNG.h"
+#include "Param.h"
+#include "IO.h"
 
+extern Param *param;
 
 /* General eNVM */
 void AnalogNVM::WriteEnergyCalculation(double wireCapCol) {
@@ -154,59 +159,54 @@ void AnalogNVM::WriteEnergyCalculation(double wireCapCol) {
 /* Ideal device (no weight update nonlinearity) */
 IdealDevice::IdealDevice(int x, int y) {
 	this->x = x; this->y = y;	// Cell location: x (column) and y (row) start from index 0
-	maxConductance = 5e-6;		// Maximum cell conductance (S)
-	minConductance = 100e-9;	    // Minimum cell conductance (S)
+	maxConductance = param->DeviceParam("IdealDevice", "maxConductance", 5e-6);		// Maximum cell conductance (S)
+	minConductance = param->DeviceParam("IdealDevice", "minConductance", 100e-9);	    // Minimum cell conductance (S)
 	avgMaxConductance = maxConductance; // Average maximum cell conductance (S)
 	avgMinConductance = minConductance; // Average minimum cell conductance (S)
 	conductance = minConductance;	// Current conductance (S) (dynamic variable)
 	conductancePrev = conductance;	// Previous conductance (S) (dynamic variable)
-	readVoltage = 0.5;	// On-chip read voltage (Vr) (V)
-	readPulseWidth = 5e-9;	// Read pulse width (s) (will be determined by ADC)
-	writeVoltageLTP = 2;	// Write voltage (V) for LTP or weight increase
-	writeVoltageLTD = 2;	// Write voltage (V) for LTD or weight decrease
-	writePulseWidthLTP = 10e-9;	// Write pulse width (s) for LTP or weight increase
-	writePulseWidthLTD = 10e-9;	// Write pulse width (s) for LTD or weight decrease
+	readVoltage = param->DeviceParam("IdealDevice", "readVoltage", 0.5);	// On-chip read voltage (Vr) (V)
+	readPulseWidth = param->DeviceParam("IdealDevice", "readPulseWidth", 5e-9);	// Read pulse width (s) (will be determined by ADC)
+	writeVoltageLTP = param->DeviceParam("IdealDevice", "writeVoltageLTP", 2);	// Write voltage (V) for LTP or weight increase
+	writeVoltageLTD = param->DeviceParam("IdealDevice", "writeVoltageLTD", 2);	// Write voltage (V) for LTD or weight decrease
+	writePulseWidthLTP = param->DeviceParam("IdealDevice", "writePulseWidthLTP", 10e-9);	// Write pulse width (s) for LTP or weight increase
+	writePulseWidthLTD = param->DeviceParam("IdealDevice", "writePulseWidthLTD", 10e-9);	// Write pulse width (s) for LTD or weight decrease
 	writeEnergy = 0;	// Dynamic variable for calculation of write energy (J)
-	maxNumLevelLTP = 64;	// Maximum number of conductance states during LTP or weight increase
-	maxNumLevelLTD = 64;	// Maximum number of conductance states during LTD or weight decrease
+	maxNumLevelLTP = param->DeviceParam("IdealDevice", "maxNumLevelLTP", 64);	// Maximum number of conductance states during LTP or weight increase
+	maxNumLevelLTD = param->DeviceParam("IdealDevice", "maxNumLevelLTD", 64);	// Maximum number of conductance states during LTD or weight decrease
 	numPulse = 0;	// Number of write pulses used in the most recent write operation (dynamic variable)
-	cmosAccess = true;	// True: Pseudo-crossbar (1T1R), false: cross-point
+	cmosAccess = param->DeviceParam("IdealDevice", "cmosAccess", true);	// True: Pseudo-crossbar (1T1R), false: cross-point
 	FeFET = false;		// True: FeFET structure (Pseudo-crossbar only, should be cmosAccess=1)
 	gateCapFeFET = 2.1717e-18;	// Gate capacitance of FeFET (F)
-	resistanceAccess = 15e3;	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
-	nonlinearIV = false;	// Consider I-V nonlinearity or not (Currently for cross-point array only)
+	resistanceAccess = param->DeviceParam("IdealDevice", "resistanceAccess", 15e3);	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
+	nonlinearIV = param->DeviceParam("IdealDevice", "nonlinearIV", false);	// Consider I-V nonlinearity or not (Currently for cross-point array only)
 	nonIdenticalPulse = false;	// Use non-identical pulse scheme in weight update or not (should be false here)
 								// Don't care other non-identical pulse parameters
-	NL = 10;	// Nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
+	NL = param->DeviceParam("IdealDevice", "NL", 10);	// Nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
 	if (nonlinearIV) {	// Currently for cross-point array only
 		double Vr_exp = readVoltage;  // XXX: Modify this value to Vr in the reported measurement data (can be different than readVoltage)
 		// Calculation of conductance at on-chip Vr
 		maxConductance = NonlinearConductance(maxConductance, NL, writeVoltageLTP, Vr_exp, readVoltage);
 		minConductance = NonlinearConductance(minConductance, NL, writeVoltageLTP, Vr_exp, readVoltage);
 	}
-	readNoise = false;	// Consider read noise or not
-	sigmaReadNoise = 0.25;	// Sigma of read noise in gaussian distribution
-	gaussian_dist = new std::normal_distribution<double>(0, sigmaReadNoise);	// Set up mean and stddev for read noise
+	readNoise = param->DeviceParam("IdealDevice", "readNoise", false);	// Consider read noise or not
+	sigmaReadNoise = param->DeviceParam("IdealDevice", "sigmaReadNoise", 0.25);	// Sigma of read noise in gaussian distribution
 	
 	/* Conductance range variation */	
-	conductanceRangeVar = false;	// Consider variation of conductance range or not
-	maxConductanceVar = 0;	// Sigma of maxConductance variation (S)
-	minConductanceVar = 0;	// Sigma of minConductance variation (S)
-	std::mt19937 localGen;
-	localGen.seed(std::time(0));
-	gaussian_dist_maxConductance = new std::normal_distribution<double>(0, maxConductanceVar);
-	gaussian_dist_minConductance = new std::normal_distribution<double>(0, minConductanceVar);
+	conductanceRangeVar = param->DeviceParam("IdealDevice", "conductanceRangeVar", false);	// Consider variation of conductance range or not
+	maxConductanceVar = param->DeviceParam("IdealDevice", "maxConductanceVar", 0);	// Sigma of maxConductance variation (S)
+	minConductanceVar = param->DeviceParam("IdealDevice", "minConductanceVar", 0);	// Sigma of minConductance variation (S)
 	if (conductanceRangeVar) {
-		maxConductance += (*gaussian_dist_maxConductance)(localGen);
-		minConductance += (*gaussian_dist_minConductance)(localGen);
+		maxConductance += maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		minConductance += minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 		if (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0 ) {	// Conductance variation check
 			puts("[Error] Conductance variation check not passed. The variation may be too large.");
 			exit(-1);
 		}
 		// Use the code below instead for re-choosing the variation if the check is not passed
 		//do {
-		//	maxConductance = avgMaxConductance + (*gaussian_dist_maxConductance)(localGen);
-		//	minConductance = avgMinConductance + (*gaussian_dist_minConductance)(localGen);
+		//	maxConductance = avgMaxConductance + maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		//	minConductance = avgMinConductance + minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 		//} while (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0);
 	}
 	
@@ -215,17 +215,15 @@ IdealDevice::IdealDevice(int x, int y) {
 }
 
 double IdealDevice::Read(double voltage) {
-	extern std::mt19937 gen;
 	// TODO: nonlinear read
 	if (readNoise) {
-		return voltage * conductance * (1 + (*gaussian_dist)(gen));
+		return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 	} else {
 		return voltage * conductance;
 	}
 }
 
 void IdealDevice::Write(double deltaWeightNormalized, double weight, double minWeight, double maxWeight) {
-	extern std::mt19937 gen;
 	if (deltaWeightNormalized >= 0) {
 		deltaWeightNormalized = deltaWeightNormalized/(maxWeight-minWeight);
 		deltaWeightNormalized = truncate(deltaWeightNormalized, maxNumLevelLTP);
@@ -256,37 +254,38 @@ void IdealDevice::Write(double deltaWeightNormalized, double weight, double minW
 }
 
 /* Real Device */
-RealDevice::RealDevice(int x, int y) { 
+RealDevice::RealDevice(int x, int y, int randomStream) { 
 	this->x = x; this->y = y;	// Cell location: x (column) and y (row) start from index 0
-	maxConductance = 3.8462e-8;		// Maximum cell conductance (S)
-	minConductance = 3.0769e-9;	// Minimum cell conductance (S)
+	this->randomStream = randomStream;
+	maxConductance = param->DeviceParam("RealDevice", "maxConductance", 3.8462e-8);		// Maximum cell conductance (S)
+	minConductance = param->DeviceParam("RealDevice", "minConductance", 3.0769e-9);	// Minimum cell conductance (S)
 	avgMaxConductance = maxConductance; // Average maximum cell conductance (S)
 	avgMinConductance = minConductance; // Average minimum cell conductance (S)
 	conductance = minConductance;	// Current conductance (S) (dynamic variable)
 	conductancePrev = conductance;	// Previous conductance (S) (dynamic variable)
-	readVoltage = 0.5;	// On-chip read voltage (Vr) (V)
-	readPulseWidth = 5e-9;	// Read pulse width (s) (will be determined by ADC)
-	writeVoltageLTP = 3.2;	// Write voltage (V) for LTP or weight increase
-	writeVoltageLTD = 2.8;	// Write voltage (V) for LTD or weight decrease
-	writePulseWidthLTP = 300e-6;	// Write pulse width (s) for LTP or weight increase
-	writePulseWidthLTD = 300e-6;	// Write pulse width (s) for LTD or weight decrease
+	readVoltage = param->DeviceParam("RealDevice", "readVoltage", 0.5);	// On-chip read voltage (Vr) (V)
+	readPulseWidth = param->DeviceParam("RealDevice", "readPulseWidth", 5e-9);	// Read pulse width (s) (will be determined by ADC)
+	writeVoltageLTP = param->DeviceParam("RealDevice", "writeVoltageLTP", 3.2);	// Write voltage (V) for LTP or weight increase
+	writeVoltageLTD = param->DeviceParam("RealDevice", "writeVoltageLTD", 2.8);	// Write voltage (V) for LTD or weight decrease
+	writePulseWidthLTP = param->DeviceParam("RealDevice", "writePulseWidthLTP", 300e-6);	// Write pulse width (s) for LTP or weight increase
+	writePulseWidthLTD = param->DeviceParam("RealDevice", "writePulseWidthLTD", 300e-6);	// Write pulse width (s) for LTD or weight decrease
 	writeEnergy = 0;	// Dynamic variable for calculation of write energy (J)
-	maxNumLevelLTP = 97;	// Maximum number of conductance states during LTP or weight increase
-	maxNumLevelLTD = 100;	// Maximum number of conductance states during LTD or weight decrease
+	maxNumLevelLTP = param->DeviceParam("RealDevice", "maxNumLevelLTP", 97);	// Maximum number of conductance states during LTP or weight increase
+	maxNumLevelLTD = param->DeviceParam("RealDevice", "maxNumLevelLTD", 100);	// Maximum number of conductance states during LTD or weight decrease
 	numPulse = 0;	// Number of write pulses used in the most recent write operation (dynamic variable)
-	cmosAccess = true;	// True: Pseudo-crossbar (1T1R), false: cross-point
+	cmosAccess = param->DeviceParam("RealDevice", "cmosAccess", true);	// True: Pseudo-crossbar (1T1R), false: cross-point
     FeFET = false;		// True: FeFET structure (Pseudo-crossbar only, should be cmosAccess=1)
 	gateCapFeFET = 2.1717e-18;	// Gate capacitance of FeFET (F)
-	resistanceAccess = 15e3;	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
-	nonlinearIV = false;	// Consider I-V nonlinearity or not (Currently for cross-point array only)
-	NL = 10;    // I-V nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
+	resistanceAccess = param->DeviceParam("RealDevice", "resistanceAccess", 15e3);	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
+	nonlinearIV = param->DeviceParam("RealDevice", "nonlinearIV", false);	// Consider I-V nonlinearity or not (Currently for cross-point array only)
+	NL = param->DeviceParam("RealDevice", "NL", 10);    // I-V nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
 	if (nonlinearIV) {  // Currently for cross-point array only
 		double Vr_exp = readVoltage;  // XXX: Modify this value to Vr in the reported measurement data (can be different than readVoltage)
 		// Calculation of conductance at on-chip Vr
 		maxConductance = NonlinearConductance(maxConductance, NL, writeVoltageLTP, Vr_exp, readVoltage);
 		minConductance = NonlinearConductance(minConductance, NL, writeVoltageLTP, Vr_exp, readVoltage);
 	}
-	nonlinearWrite = true;	// Consider weight update nonlinearity or not
+	nonlinearWrite = param->DeviceParam("RealDevice", "nonlinearWrite", true);	// Consider weight update nonlinearity or not
 	nonIdenticalPulse = false;	// Use non-identical pulse scheme in weight update or not
 	if (nonIdenticalPulse) {
 		VinitLTP = 2.85;	// Initial write voltage for LTP or weight increase (V)
@@ -299,61 +298,58 @@ RealDevice::RealDevice(int x, int y) {
 		PWstepLTD = 5e-9;	// Write pulse width for LTD or weight decrease (s)
 		writeVoltageSquareSum = 0;	// Sum of V^2 of non-identical pulses (dynamic variable)
 	}
-	readNoise = false;		// Consider read noise or not
-	sigmaReadNoise = 0;		// Sigma of read noise in gaussian distribution
-	gaussian_dist = new std::normal_distribution<double>(0, sigmaReadNoise);	// Set up mean and stddev for read noise
+	readNoise = param->DeviceParam("RealDevice", "readNoise", false);		// Consider read noise or not
+	sigmaReadNoise = param->DeviceParam("RealDevice", "sigmaReadNoise", 0);		// Sigma of read noise in gaussian distribution
 
-	std::mt19937 localGen;	// It's OK not to use the external gen, since here the device-to-device vairation is a one-time deal
-	localGen.seed(std::time(0));
-	
 	/* Device-to-device weight update variation */
-	NL_LTP = 2.4;	// LTP nonlinearity
-	NL_LTD = -4.88;	// LTD nonlinearity
-	sigmaDtoD = 0;	// Sigma of device-to-device weight update vairation in gaussian distribution
-	gaussian_dist2 = new std::normal_distribution<double>(0, sigmaDtoD);	// Set up mean and stddev for device-to-device weight update vairation
-	paramALTP = getParamA(NL_LTP + (*gaussian_dist2)(localGen)) * maxNumLevelLTP;	// Parameter A for LTP nonlinearity
-	paramALTD = getParamA(NL_LTD + (*gaussian_dist2)(localGen)) * maxNumLevelLTD;	// Parameter A for LTD nonlinearity
+	NL_LTP = param->DeviceParam("RealDevice", "NL_LTP", 2.4);	// LTP nonlinearity
+	NL_LTD = param->DeviceParam("RealDevice", "NL_LTD", -4.88);	// LTD nonlinearity
+	sigmaDtoD = param->DeviceParam("RealDevice", "sigmaDtoD", 0);	// Sigma of device-to-device weight update vairation in gaussian distribution
+	paramALTP = getParamA(NL_LTP + sigmaDtoD * RandomNormal(x, y, randomStream, RANDOM_D2D_NL_LTP)) * maxNumLevelLTP;	// Parameter A for LTP nonlinearity
+	paramALTD = getParamA(NL_LTD + sigmaDtoD * RandomNormal(x, y, randomStream, RANDOM_D2D_NL_LTD)) * maxNumLevelLTD;	// Parameter A for LTD nonlinearity
 
 	/* Cycle-to-cycle weight update variation */
-	sigmaCtoC = 0.035* (maxConductance - minConductance);	// Sigma of cycle-to-cycle weight update vairation: defined as the percentage of conductance range
-	gaussian_dist3 = new std::normal_distribution<double>(0, sigmaCtoC);    // Set up mean and stddev for cycle-to-cycle weight update vairation
+	sigmaCtoC = param->DeviceParam("RealDevice", "sigmaCtoC", 0.035) * (maxConductance - minConductance);	// Sigma of cycle-to-cycle weight update vairation: defined as the percentage of conductance range
 
 	/* Conductance range variation */
-	conductanceRangeVar = false;    // Consider variation of conductance range or not
-	maxConductanceVar = 0;  // Sigma of maxConductance variation (S)
-	minConductanceVar = 0;  // Sigma of minConductance variation (S)
-	gaussian_dist_maxConductance = new std::normal_distribution<double>(0, maxConductanceVar);
-	gaussian_dist_minConductance = new std::normal_distribution<double>(0, minConductanceVar);
+	conductanceRangeVar = param->DeviceParam("RealDevice", "conductanceRangeVar", false);    // Consider variation of conductance range or not
+	maxConductanceVar = param->DeviceParam("RealDevice", "maxConductanceVar", 0);  // Sigma of maxConductance variation (S)
+	minConductanceVar = param->DeviceParam("RealDevice", "minConductanceVar", 0);  // Sigma of minConductance variation (S)
 	if (conductanceRangeVar) {
-		maxConductance += (*gaussian_dist_maxConductance)(localGen);
-		minConductance += (*gaussian_dist_minConductance)(localGen);
+		maxConductance += maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		minConductance += minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 		if (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0 ) {    // Conductance variation check
 			puts("[Error] Conductance variation check not passed. The variation may be too large.");
 			exit(-1);
 		}
 		// Use the code below instead for re-choosing the variation if the check is not passed
 		//do {
-		//  maxConductance = avgMaxConductance + (*gaussian_dist_maxConductance)(localGen);
-		//  minConductance = avgMinConductance + (*gaussian_dist_minConductance)(localGen);
+		//  maxConductance = avgMaxConductance + maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		//  minConductance = avgMinConductance + minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 		//} while (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0);
 	}
+	UpdateParamB();
  
         heightInFeatureSize = cmosAccess? 4 : 2; // Cell height = 4F (Pseudo-crossbar) or 2F (cross-point)
         widthInFeatureSize = cmosAccess? (FeFET? 6 : 4) : 2; //// Cell width = 6F (FeFET) or 4F (Pseudo-crossbar) or 2F (cross-point)
 }
+
+void RealDevice::UpdateParamB() {
+	paramBLTP = (maxConductance - minConductance) / (1 - exp(-maxNumLevelLTP/paramALTP));
+	paramBLTD = (maxConductance - minConductance) / (1 - exp(-maxNumLevelLTD/paramALTD));
+}
  
 double RealDevice::Read(double voltage) {	// Return read current (A)
-	extern std::mt19937 gen;
 	if (nonlinearIV) {
 		// TODO: nonlinear read
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
 	} else {
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
@@ -367,9 +363,11 @@ void RealDevice::Write(double deltaWeightNormalized, double weight, double minWe
 		deltaWeightNormalized = truncate(deltaWeightNormalized, maxNumLevelLTP);
 		numPulse = deltaWeightNormalized * maxNumLevelLTP;
 		if (nonlinearWrite) {
-			paramBLTP = (maxConductance - minConductance) / (1 - exp(-maxNumLevelLTP/paramALTP));
-			xPulse = InvNonlinearWeight(conductance, maxNumLevelLTP, paramALTP, paramBLTP, minConductance);
-			conductanceNew = NonlinearWeight(xPulse+numPulse, maxNumLevelLTP, paramALTP, paramBLTP, minConductance);
+			/* NonlinearWeight(InvNonlinearWeight(conductance)+numPulse) in closed form, so only one exp per write */
+			conductanceNew = conductance - (paramBLTP - (conductance - minConductance)) * expm1(-numPulse/paramALTP);
+			if (nonIdenticalPulse) {	// The pulse position is only needed for the voltage and width of each pulse
+				xPulse = InvNonlinearWeight(conductance, maxNumLevelLTP, paramALTP, paramBLTP, minConductance);
+			}
 		} else {
 			xPulse = (conductance - minConductance) / (maxConductance - minConductance) * maxNumLevelLTP;
 			conductanceNew = (xPulse+numPulse) / maxNumLevelLTP * (maxConductance - minConductance) + minConductance;
@@ -379,9 +377,10 @@ void RealDevice::Write(double deltaWeightNormalized, double weight, double minWe
 		deltaWeightNormalized = truncate(deltaWeightNormalized, maxNumLevelLTD);
 		numPulse = deltaWeightNormalized * maxNumLevelLTD;
 		if (nonlinearWrite) {
-			paramBLTD = (maxConductance - minConductance) / (1 - exp(-maxNumLevelLTD/paramALTD));
-			xPulse = InvNonlinearWeight(conductance, maxNumLevelLTD, paramALTD, paramBLTD, minConductance);
-			conductanceNew = NonlinearWeight(xPulse+numPulse, maxNumLevelLTD, paramALTD, paramBLTD, minConductance);
+			conductanceNew = conductance - (paramBLTD - (conductance - minConductance)) * expm1(-numPulse/paramALTD);
+			if (nonIdenticalPulse) {
+				xPulse = InvNonlinearWeight(conductance, maxNumLevelLTD, paramALTD, paramBLTD, minConductance);
+			}
 		} else {
 			xPulse = (conductance - minConductance) / (maxConductance - minConductance) * maxNumLevelLTD;
 			conductanceNew = (xPulse+numPulse) / maxNumLevelLTD * (maxConductance - minConductance) + minConductance;
@@ -389,9 +388,8 @@ void RealDevice::Write(double deltaWeightNormalized, double weight, double minWe
 	}
 
 	/* Cycle-to-cycle variation */
-	extern std::mt19937 gen;
 	if (sigmaCtoC && numPulse != 0) {
-		conductanceNew += (*gaussian_dist3)(gen) * sqrt(abs(numPulse));	// Absolute variation
+		conductanceNew += sigmaCtoC * RandomNormal(x, y, randomStream, RANDOM_WRITE_NOISE) * sqrt(abs(numPulse));	// Absolute variation
 	}
 	
 	if (conductanceNew > maxConductance) {
@@ -413,23 +411,11 @@ void RealDevice::Write(double deltaWeightNormalized, double weight, double minWe
 		writeLatencyLTP = 0;
 		writeLatencyLTD = 0;
 		writeVoltageSquareSum = 0;
-		double V = 0;
-		double PW = 0;
 		if (numPulse > 0) { // LTP
-			for (int i=0; i<numPulse; i++) {
-				V = VinitLTP + (xPulse+i) * VstepLTP;
-				PW = PWinitLTP + (xPulse+i) * PWstepLTP;
-				writeLatencyLTP += PW;
-				writeVoltageSquareSum += V * V;
-			}
+			IncrementalPulseSums(numPulse, xPulse, VinitLTP, VstepLTP, PWinitLTP, PWstepLTP, &writeLatencyLTP, &writeVoltageSquareSum);
 			writePulseWidthLTP = writeLatencyLTP / numPulse;
 		} else {    // LTD
-			for (int i=0; i<(-numPulse); i++) {
-				V = VinitLTD + (maxNumLevelLTD-xPulse+i) * VstepLTD;
-				PW = PWinitLTD + (maxNumLevelLTD-xPulse+i) * PWstepLTD;
-				writeLatencyLTD += PW;
-				writeVoltageSquareSum += V * V;
-			}
+			IncrementalPulseSums(-numPulse, maxNumLevelLTD-xPulse, VinitLTD, VstepLTD, PWinitLTD, PWstepLTD, &writeLatencyLTD, &writeVoltageSquareSum);
 			writePulseWidthLTD = writeLatencyLTD / (-numPulse);
 		}
 	}
@@ -438,23 +424,83 @@ void RealDevice::Write(double deltaWeightNormalized, double weight, double minWe
 	conductance = conductanceNew;
 }
 
+/* Conductance curves of MeasuredDevice, from measuredDataFile or the data here. They are built and checked by the first cell
+   only, the other cells share the same read-only curves */
+static void LoadMeasuredCurves(MeasuredCurve &dataConductanceLTP, MeasuredCurve &dataConductanceLTD, bool &symLTPandLTD) {
+	static std::string loadedFileName;
+	static MeasuredCurve loadedLTP, loadedLTD;
+	static bool loadedSymLTPandLTD;
+	#pragma omp critical(LoadMeasuredCurves)
+	{
+		if (!loadedLTP || loadedFileName != param->measuredDataFile) {
+			std::vector<double> LTP, LTD;
+			bool sym = false;	// True: use LTP conductance data for LTD
+
+			/* LTP */
+			double rawDataConductanceLTP[] = {0,1.00e-09,2.00e-09,3.00e-09,4.00e-09,5.00e-09,6.00e-09,7.00e-09,8.00e-09,9.00e-09,1.00e-08,1.10e-08,1.20e-08,1.30e-08,1.40e-08,1.50e-08,1.60e-08,1.70e-08,1.80e-08,1.90e-08,2.00e-08,2.10e-08,2.20e-08,2.30e-08,2.40e-08,2.50e-08,2.60e-08,2.70e-08,2.80e-08,2.90e-08,3.00e-08,3.10e-08,3.20e-08,3.30e-08,3.40e-08,3.50e-08,3.60e-08,3.70e-08,3.80e-08,3.90e-08,4.00e-08,4.10e-08,4.20e-08,4.30e-08,4.40e-08,4.50e-08,4.60e-08,4.70e-08,4.80e-08,4.90e-08,5.00e-08,5.10e-08,5.20e-08,5.30e-08,5.40e-08,5.50e-08,5.60e-08,5.70e-08,5.80e-08,5.90e-08,6.00e-08,6.10e-08,6.20e-08,6.30e-08};
+			if (param->measuredDataFile[0]) {	// Use the curves in the file instead of the data here
+				ReadMeasuredDataFromFile(param->measuredDataFile, LTP, LTD);
+				sym = LTD.empty();
+			} else {
+				LTP.insert(LTP.begin(), rawDataConductanceLTP, rawDataConductanceLTP + sizeof(rawDataConductanceLTP)/sizeof(rawDataConductanceLTP[0]));
+			}
+			/* LTD */
+			if (sym) {	// Use LTP conductance data for LTD
+				LTD.assign(LTP.rbegin(), LTP.rend());
+			} else if (LTD.empty()) {	// Use provided LTD conductance data
+				double rawDataConductanceLTD[] = {6.30e-08,6.20e-08,6.10e-08,6.00e-08,5.90e-08,5.80e-08,5.70e-08,5.60e-08,5.50e-08,5.40e-08,5.30e-08,5.20e-08,5.10e-08,5.00e-08,4.90e-08,4.80e-08,4.70e-08,4.60e-08,4.50e-08,4.40e-08,4.30e-08,4.20e-08,4.10e-08,4.00e-08,3.90e-08,3.80e-08,3.70e-08,3.60e-08,3.50e-08,3.40e-08,3.30e-08,3.20e-08,3.10e-08,3.00e-08,2.90e-08,2.80e-08,2.70e-08,2.60e-08,2.50e-08,2.40e-08,2.30e-08,2.20e-08,2.10e-08,2.00e-08,1.90e-08,1.80e-08,1.70e-08,1.60e-08,1.50e-08,1.40e-08,1.30e-08,1.20e-08,1.10e-08,1.00e-08,9.00e-09,8.00e-09,7.00e-09,6.00e-09,5.00e-09,4.00e-09,3.00e-09,2.00e-09,1.00e-09,0};
+				LTD.insert(LTD.begin(), rawDataConductanceLTD, rawDataConductanceLTD + sizeof(rawDataConductanceLTD)/sizeof(rawDataConductanceLTD[0]));
+			}
+
+			// Data check
+			/* Check if the conductance range of LTP and LTD are consistent */
+			if (LTP.back() != LTD.front() || LTP.front() != LTD.back()) {
+				puts("[Error] Conductance range of LTP and LTD are not consistent");
+				exit(-1);
+			}
+			/* Check if LTP conductance is monotonically increasing */
+			for (size_t i=1; i<LTP.size(); i++) {
+				if (LTP[i] - LTP[i-1] <= 0) {
+					puts("[Error] LTP conductance should be monotonically increasing");
+					exit(-1);
+				}
+			}
+			/* Check if LTD conductance is monotonically decreasing */
+			for (size_t i=1; i<LTD.size(); i++) {
+				if (LTD[i] - LTD[i-1] >= 0) {
+					puts("[Error] LTD conductance should be monotonically decreasing");
+					exit(-1);
+				}
+			}
+
+			loadedLTP = MeasuredCurve(new std::vector<double>(LTP));
+			loadedLTD = MeasuredCurve(new std::vector<double>(LTD));
+			loadedSymLTPandLTD = sym;
+			loadedFileName = param->measuredDataFile;
+		}
+		dataConductanceLTP = loadedLTP;
+		dataConductanceLTD = loadedLTD;
+		symLTPandLTD = loadedSymLTPandLTD;
+	}
+}
+
 /* Measured device */
 MeasuredDevice::MeasuredDevice(int x, int y) {
 	this->x = x; this->y = y;	// Cell location: x (column) and y (row) start from index 0
-	readVoltage = 0.5;	// On-chip read voltage (Vr) (V)
-	readPulseWidth = 5e-9;	// Read pulse width (s) (will be determined by ADC)
-	writeVoltageLTP = 2;	// Write voltage (V) for LTP or weight increase
-	writeVoltageLTD = 2;	// Write voltage (V) for LTD or weight decrease
-	writePulseWidthLTP = 100e-9;	// Write pulse width (s) for LTP or weight increase
-	writePulseWidthLTD = 100e-9;	// Write pulse width (s) for LTD or weight decrease
+	readVoltage = param->DeviceParam("MeasuredDevice", "readVoltage", 0.5);	// On-chip read voltage (Vr) (V)
+	readPulseWidth = param->DeviceParam("MeasuredDevice", "readPulseWidth", 5e-9);	// Read pulse width (s) (will be determined by ADC)
+	writeVoltageLTP = param->DeviceParam("MeasuredDevice", "writeVoltageLTP", 2);	// Write voltage (V) for LTP or weight increase
+	writeVoltageLTD = param->DeviceParam("MeasuredDevice", "writeVoltageLTD", 2);	// Write voltage (V) for LTD or weight decrease
+	writePulseWidthLTP = param->DeviceParam("MeasuredDevice", "writePulseWidthLTP", 100e-9);	// Write pulse width (s) for LTP or weight increase
+	writePulseWidthLTD = param->DeviceParam("MeasuredDevice", "writePulseWidthLTD", 100e-9);	// Write pulse width (s) for LTD or weight decrease
 	writeEnergy = 0;	// Dynamic variable for calculation of write energy (J)
 	numPulse = 0;	// Number of write pulses used in the most recent write operation (dynamic variable)
-	cmosAccess = true;	// True: Pseudo-crossbar (1T1R), false: cross-point
+	cmosAccess = param->DeviceParam("MeasuredDevice", "cmosAccess", true);	// True: Pseudo-crossbar (1T1R), false: cross-point
 	FeFET = false;		// True: FeFET structure (Pseudo-crossbar only, should be cmosAccess=1)
 	gateCapFeFET = 2.1717e-18;	// Gate capacitance of FeFET (F)
-	resistanceAccess = 15e3;	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
-	nonlinearIV = false;	// Currently for cross-point array only
-	nonlinearWrite = false;	// Consider weight update nonlinearity or not
+	resistanceAccess = param->DeviceParam("MeasuredDevice", "resistanceAccess", 15e3);	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
+	nonlinearIV = param->DeviceParam("MeasuredDevice", "nonlinearIV", false);	// Currently for cross-point array only
+	nonlinearWrite = param->DeviceParam("MeasuredDevice", "nonlinearWrite", false);	// Consider weight update nonlinearity or not
 	nonIdenticalPulse = false;	// Use non-identical pulse scheme in weight update or not
 	if (nonIdenticalPulse) {
 		VinitLTP = 2.85;    // Initial write voltage for LTP or weight increase (V)
@@ -467,72 +513,35 @@ MeasuredDevice::MeasuredDevice(int x, int y) {
 		PWstepLTD = 5e-9;   // Write pulse width for LTD or weight decrease (s)
 		writeVoltageSquareSum = 0;  // Sum of V^2 of non-identical pulses (dynamic variable)
 	}
-	readNoise = false;		// Consider read noise or not
-	sigmaReadNoise = 0.0289;	// Sigma of read noise in gaussian distribution
-	NL = 10;	// Nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
-	gaussian_dist = new std::normal_distribution<double>(0, sigmaReadNoise);    // Set up mean and stddev for read noise
-	symLTPandLTD = false;	// True: use LTP conductance data for LTD
-
-	/* LTP */
-	double rawDataConductanceLTP[] = {0,1.00e-09,2.00e-09,3.00e-09,4.00e-09,5.00e-09,6.00e-09,7.00e-09,8.00e-09,9.00e-09,1.00e-08,1.10e-08,1.20e-08,1.30e-08,1.40e-08,1.50e-08,1.60e-08,1.70e-08,1.80e-08,1.90e-08,2.00e-08,2.10e-08,2.20e-08,2.30e-08,2.40e-08,2.50e-08,2.60e-08,2.70e-08,2.80e-08,2.90e-08,3.00e-08,3.10e-08,3.20e-08,3.30e-08,3.40e-08,3.50e-08,3.60e-08,3.70e-08,3.80e-08,3.90e-08,4.00e-08,4.10e-08,4.20e-08,4.30e-08,4.40e-08,4.50e-08,4.60e-08,4.70e-08,4.80e-08,4.90e-08,5.00e-08,5.10e-08,5.20e-08,5.30e-08,5.40e-08,5.50e-08,5.60e-08,5.70e-08,5.80e-08,5.90e-08,6.00e-08,6.10e-08,6.20e-08,6.30e-08};
-	dataConductanceLTP.insert(dataConductanceLTP.begin(), rawDataConductanceLTP, rawDataConductanceLTP + sizeof(rawDataConductanceLTP)/sizeof(rawDataConductanceLTP[0]));	// Put the raw data into a member variable of vector
-	maxNumLevelLTP = dataConductanceLTP.size() - 1;
-	/* LTD */
-	if (symLTPandLTD) {	// Use LTP conductance data for LTD
-		for (int i=maxNumLevelLTP; i>=0; i--) {
-			dataConductanceLTD.push_back(dataConductanceLTP[i]);
-		}
-		maxNumLevelLTD = dataConductanceLTD.size() - 1;
-	} else {	// Use provided LTD conductance data
-		double rawDataConductanceLTD[] = {6.30e-08,6.20e-08,6.10e-08,6.00e-08,5.90e-08,5.80e-08,5.70e-08,5.60e-08,5.50e-08,5.40e-08,5.30e-08,5.20e-08,5.10e-08,5.00e-08,4.90e-08,4.80e-08,4.70e-08,4.60e-08,4.50e-08,4.40e-08,4.30e-08,4.20e-08,4.10e-08,4.00e-08,3.90e-08,3.80e-08,3.70e-08,3.60e-08,3.50e-08,3.40e-08,3.30e-08,3.20e-08,3.10e-08,3.00e-08,2.90e-08,2.80e-08,2.70e-08,2.60e-08,2.50e-08,2.40e-08,2.30e-08,2.20e-08,2.10e-08,2.00e-08,1.90e-08,1.80e-08,1.70e-08,1.60e-08,1.50e-08,1.40e-08,1.30e-08,1.20e-08,1.10e-08,1.00e-08,9.00e-09,8.00e-09,7.00e-09,6.00e-09,5.00e-09,4.00e-09,3.00e-09,2.00e-09,1.00e-09,0};
-		dataConductanceLTD.insert(dataConductanceLTD.begin(), rawDataConductanceLTD, rawDataConductanceLTD + sizeof(rawDataConductanceLTD)/sizeof(rawDataConductanceLTD[0]));	// Put the raw data into a member variable of vector
-		maxNumLevelLTD = dataConductanceLTD.size() - 1;
-	}
+	readNoise = param->DeviceParam("MeasuredDevice", "readNoise", false);		// Consider read noise or not
+	sigmaReadNoise = param->DeviceParam("MeasuredDevice", "sigmaReadNoise", 0.0289);	// Sigma of read noise in gaussian distribution
+	NL = param->DeviceParam("MeasuredDevice", "NL", 10);	// Nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
+	LoadMeasuredCurves(dataConductanceLTP, dataConductanceLTD, symLTPandLTD);
+	maxNumLevelLTP = dataConductanceLTP->size() - 1;
+	maxNumLevelLTD = dataConductanceLTD->size() - 1;
 	/* Define max/min/initial conductance */
-	maxConductance = (dataConductanceLTP.back() > dataConductanceLTD.front())? dataConductanceLTD.front() : dataConductanceLTP.back();      // The last conductance point of LTP or the first conductance point of LTD, depending on which one is smaller
-	minConductance = (dataConductanceLTP.front() > dataConductanceLTD.back())? dataConductanceLTP.front() : dataConductanceLTD.back();  // The first conductance point of LTP or the last conductance point of LTD, depending on which one is larger
+	maxConductance = (dataConductanceLTP->back() > dataConductanceLTD->front())? dataConductanceLTD->front() : dataConductanceLTP->back();      // The last conductance point of LTP or the first conductance point of LTD, depending on which one is smaller
+	minConductance = (dataConductanceLTP->front() > dataConductanceLTD->back())? dataConductanceLTP->front() : dataConductanceLTD->back();  // The first conductance point of LTP or the last conductance point of LTD, depending on which one is larger
 	avgMaxConductance = maxConductance; // Average maximum cell conductance (S)
 	avgMinConductance = minConductance; // Average minimum cell conductance (S)
 	conductance = minConductance;
 	conductancePrev = conductance;
 
-	// Data check
-	/* Check if the conductance range of LTP and LTD are consistent */
-	if (dataConductanceLTP.back() != dataConductanceLTD.front() || dataConductanceLTP.front() != dataConductanceLTD.back()) {
-		puts("[Error] Conductance range of LTP and LTD are not consistent");
-		exit(-1);
-	}
-	/* Check if LTP conductance is monotonically increasing */
-	for (int i=1; i<=maxNumLevelLTP; i++) {
-		if (dataConductanceLTP[i] - dataConductanceLTP[i-1] <= 0) {
-			puts("[Error] LTP conductance should be monotonically increasing");
-			exit(-1);
-		}
-	}
-	/* Check if LTD conductance is monotonically decreasing */
-	for (int i=1; i<=maxNumLevelLTD; i++) {
-		if (dataConductanceLTD[i] - dataConductanceLTD[i-1] >= 0) {
-			puts("[Error] LTD conductance should be monotonically decreasing");
-			exit(-1);
-		}
-	}
-
 	heightInFeatureSize = cmosAccess? 4 : 2;	// Cell height = 4F (Pseudo-crossbar) or 2F (cross-point)
 	widthInFeatureSize = cmosAccess? (FeFET? 6 : 4) : 2;	// Cell width = 6F (FeFET) or 4F (Pseudo-crossbar) or 2F (cross-point)
 }
 
 double MeasuredDevice::Read(double voltage) {	// Return read current (A)
-	extern std::mt19937 gen;
 	if (nonlinearIV) {
 		// TODO: nonlinear read
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
 	} else {
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
@@ -546,8 +555,8 @@ void MeasuredDevice::Write(double deltaWeightNormalized, double weight, double m
 		deltaWeightNormalized = truncate(deltaWeightNormalized, maxNumLevelLTP);
 		numPulse = deltaWeightNormalized * maxNumLevelLTP;
 		if (nonlinearWrite) {
-			xPulse = InvMeasuredLTP(conductance, maxNumLevelLTP, dataConductanceLTP);
-			conductanceNew = MeasuredLTP(xPulse+numPulse, maxNumLevelLTP, dataConductanceLTP);
+			xPulse = InvMeasuredLTP(conductance, maxNumLevelLTP, *dataConductanceLTP);
+			conductanceNew = MeasuredLTP(xPulse+numPulse, maxNumLevelLTP, *dataConductanceLTP);
 		} else {
 			xPulse = (conductance - minConductance) / (maxConductance - minConductance) * maxNumLevelLTP;
 			conductanceNew = (weight-minWeight)/(maxWeight-minWeight) * (maxConductance - minConductance) + minConductance;
@@ -560,8 +569,8 @@ void MeasuredDevice::Write(double deltaWeightNormalized, double weight, double m
 		deltaWeightNormalized = truncate(deltaWeightNormalized, maxNumLevelLTD);
 		numPulse = deltaWeightNormalized * maxNumLevelLTD;
 		if (nonlinearWrite) {
-			xPulse = InvMeasuredLTP(conductance, maxNumLevelLTP, dataConductanceLTP);
-			conductanceNew = MeasuredLTP(xPulse+numPulse, maxNumLevelLTP, dataConductanceLTP);	// Use xPulse-numPulse here because the conductance will decrease with larger pulse position in dataConductanceLTD
+			xPulse = InvMeasuredLTP(conductance, maxNumLevelLTP, *dataConductanceLTP);
+			conductanceNew = MeasuredLTP(xPulse+numPulse, maxNumLevelLTP, *dataConductanceLTP);	// Use xPulse-numPulse here because the conductance will decrease with larger pulse position in dataConductanceLTD
 		} else {
 			xPulse = (conductance - minConductance) / (maxConductance - minConductance) * maxNumLevelLTD;
 			conductanceNew = (weight-minWeight)/(maxWeight-minWeight) * (maxConductance - minConductance) + minConductance;
@@ -584,23 +593,11 @@ void MeasuredDevice::Write(double deltaWeightNormalized, double weight, double m
 		writeLatencyLTP = 0;
 		writeLatencyLTD = 0;
 		writeVoltageSquareSum = 0;
-		double V = 0;
-		double PW = 0;
 		if (numPulse > 0) { // LTP
-			for (int i=0; i<numPulse; i++) {
-				V = VinitLTP + (xPulse+i) * VstepLTP;
-				PW = PWinitLTP + (xPulse+i) * PWstepLTP;
-				writeLatencyLTP += PW;
-				writeVoltageSquareSum += V * V;
-			}
+			IncrementalPulseSums(numPulse, xPulse, VinitLTP, VstepLTP, PWinitLTP, PWstepLTP, &writeLatencyLTP, &writeVoltageSquareSum);
 			writePulseWidthLTP = writeLatencyLTP / numPulse;
 		} else {    // LTD
-			for (int i=0; i<(-numPulse); i++) {
-				V = VinitLTD + (maxNumLevelLTD-xPulse+i) * VstepLTD;
-				PW = PWinitLTD + (maxNumLevelLTD-xPulse+i) * PWstepLTD;
-				writeLatencyLTD += PW;
-				writeVoltageSquareSum += V * V;
-			}
+			IncrementalPulseSums(-numPulse, maxNumLevelLTD-xPulse, VinitLTD, VstepLTD, PWinitLTD, PWstepLTD, &writeLatencyLTD, &writeVoltageSquareSum);
 			writePulseWidthLTD = writeLatencyLTD / (-numPulse);
 		}
 	}
@@ -632,35 +629,34 @@ DigitalNVM::DigitalNVM(int x, int y) {
 	this->x = x; this->y = y;	// Cell location: x (column) and y (row) start from index 0	
 	bit = 0;	// Stored bit (1 or 0) (dynamic variable), for internel check only and not be used for read
 	bitPrev = 0;	// Previous bit
-	maxConductance = 1/(8e3);		// Maximum cell conductance (S)
-	minConductance = 1/(24*1e3);	// Minimum cell conductance (S)
+	maxConductance = param->DeviceParam("DigitalNVM", "maxConductance", 1/(8e3));		// Maximum cell conductance (S)
+	minConductance = param->DeviceParam("DigitalNVM", "minConductance", 1/(24*1e3));	// Minimum cell conductance (S)
 	avgMaxConductance = maxConductance; // Average maximum cell conductance (S)
 	avgMinConductance = minConductance; // Average minimum cell conductance (S)
 	conductance = minConductance;	// Current conductance (S) (dynamic variable)
 	conductancePrev = conductance;	// Previous conductance (S) (dynamic variable)
-	readVoltage = 0.5;	// On-chip read voltage (Vr) (V)
-	readPulseWidth = 5e-9;	// Read pulse width (s) (will be determined by S/A)
-	writeVoltageLTP = 1;	// Write voltage (V) for LTP or weight increase
-	writeVoltageLTD = 1;	// Write voltage (V) for LTD or weight decrease
-	writePulseWidthLTP = 10e-9;	// Write pulse width (s) for LTP or weight increase
-	writePulseWidthLTD = 10e-9;	// Write pulse width (s) for LTD or weight decrease
+	readVoltage = param->DeviceParam("DigitalNVM", "readVoltage", 0.5);	// On-chip read voltage (Vr) (V)
+	readPulseWidth = param->DeviceParam("DigitalNVM", "readPulseWidth", 5e-9);	// Read pulse width (s) (will be determined by S/A)
+	writeVoltageLTP = param->DeviceParam("DigitalNVM", "writeVoltageLTP", 1);	// Write voltage (V) for LTP or weight increase
+	writeVoltageLTD = param->DeviceParam("DigitalNVM", "writeVoltageLTD", 1);	// Write voltage (V) for LTD or weight decrease
+	writePulseWidthLTP = param->DeviceParam("DigitalNVM", "writePulseWidthLTP", 10e-9);	// Write pulse width (s) for LTP or weight increase
+	writePulseWidthLTD = param->DeviceParam("DigitalNVM", "writePulseWidthLTD", 10e-9);	// Write pulse width (s) for LTD or weight decrease
 	readEnergy = 0;		// Read pulse width (s) (currently not used)
 	writeEnergy = 0;    // Dynamic variable for calculation of write energy (J)
-	cmosAccess = true;	// True: Pseudo-crossbar (1T1R), false: cross-point
+	cmosAccess = param->DeviceParam("DigitalNVM", "cmosAccess", true);	// True: Pseudo-crossbar (1T1R), false: cross-point
     isSTTMRAM = false;  // if it is STTMRAM, then, we can relax the cell area
     parallelRead = true; // if it is a parallel readout scheme
-	resistanceAccess = 5e3;	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
-	nonlinearIV = false;	// Consider I-V nonlinearity or not (Currently for cross-point array only)
-	NL = 10;    // Nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
+	resistanceAccess = param->DeviceParam("DigitalNVM", "resistanceAccess", 5e3);	// The resistance of transistor (Ohm) in Pseudo-crossbar array when turned ON
+	nonlinearIV = param->DeviceParam("DigitalNVM", "nonlinearIV", false);	// Consider I-V nonlinearity or not (Currently for cross-point array only)
+	NL = param->DeviceParam("DigitalNVM", "NL", 10);    // Nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
 	if (nonlinearIV) {  // Currently for cross-point array only
 		double Vr_exp = readVoltage;  // XXX: Modify this value to Vr in the reported measurement data (can be different than readVoltage)
 		// Calculation of conductance at on-chip Vr
 		maxConductance = NonlinearConductance(maxConductance, NL, writeVoltageLTP, Vr_exp, readVoltage);
 		minConductance = NonlinearConductance(minConductance, NL, writeVoltageLTP, Vr_exp, readVoltage);
 	}
-	readNoise = false;		// Consider read noise or not
-	sigmaReadNoise = 0.25;	// Sigma of read noise in gaussian distribution
-	gaussian_dist = new std::normal_distribution<double>(0, sigmaReadNoise);    // Set up mean and stddev for read noise
+	readNoise = param->DeviceParam("DigitalNVM", "readNoise", false);		// Consider read noise or not
+	sigmaReadNoise = param->DeviceParam("DigitalNVM", "sigmaReadNoise", 0.25);	// Sigma of read noise in gaussian distribution
     if(cmosAccess){ // the reference current for 1T1R cell, should include the resistance
         double Rmax=1/maxConductance;
         double Rmin=1/minConductance;
@@ -671,24 +667,20 @@ DigitalNVM::DigitalNVM(int x, int y) {
     }
 
 	/* Conductance range variation */
-	conductanceRangeVar =false;    // Consider variation of conductance range or not
-	maxConductanceVar = 0.07*maxConductance;  // Sigma of maxConductance variation (S)
-	minConductanceVar = 0.07*minConductance;  // Sigma of minConductance variation (S)
-	std::mt19937 localGen;
-	localGen.seed(std::time(0));
-	gaussian_dist_maxConductance = new std::normal_distribution<double>(0, maxConductanceVar);
-	gaussian_dist_minConductance = new std::normal_distribution<double>(0, minConductanceVar);
+	conductanceRangeVar = param->DeviceParam("DigitalNVM", "conductanceRangeVar", false);    // Consider variation of conductance range or not
+	maxConductanceVar = param->DeviceParam("DigitalNVM", "maxConductanceVar", 0.07*maxConductance);  // Sigma of maxConductance variation (S)
+	minConductanceVar = param->DeviceParam("DigitalNVM", "minConductanceVar", 0.07*minConductance);  // Sigma of minConductance variation (S)
 	if (conductanceRangeVar) {
-		maxConductance += (*gaussian_dist_maxConductance)(localGen);
-		minConductance += (*gaussian_dist_minConductance)(localGen);
+		maxConductance += maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		minConductance += minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 	if (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0 ) {    // Conductance variation check
 			puts("[Error] Conductance variation check not passed. The variation may be too large.");
 			exit(-1);
 		}
 		// Use the code below instead for re-choosing the variation if the check is not passed
 		//do {
-		//  maxConductance = avgMaxConductance + (*gaussian_dist_maxConductance)(localGen);
-		//  minConductance = avgMinConductance + (*gaussian_dist_minConductance)(localGen);
+		//  maxConductance = avgMaxConductance + maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		//  minConductance = avgMinConductance + minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 		//} while (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0);
 	}
 
@@ -697,17 +689,16 @@ DigitalNVM::DigitalNVM(int x, int y) {
 }
 
 double DigitalNVM::Read(double voltage) {	// Return read current (A)
-	extern std::mt19937 gen;
 	if (nonlinearIV) {
 		// TODO: nonlinear read
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
 	} else {
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
@@ -815,34 +806,27 @@ _3T1C:: _3T1C(int x, int y) {
     /* device non-ideal effect */
     readNoise = false;	// Consider read noise or not
     sigmaReadNoise = 0;	// Sigma of read noise in gaussian distribution
-	gaussian_dist = new std::normal_distribution<double>(0, sigmaReadNoise);	// Set up mean and stddev for read noise
 
 	nonlinearWrite = true;	// Consider weight update nonlinearity or not
 
-	std::mt19937 localGen;	// It's OK not to use the external gen, since here the device-to-device vairation is a one-time deal
-	localGen.seed(std::time(0));
 	
 	/* Device-to-device weight update variation */
 	NL_LTP = 0.2;	// LTP nonlinearity
 	NL_LTD = -0.2;  // LTD nonlinearity
 	sigmaDtoD = 0;	// Sigma of device-to-device weight update vairation in gaussian distribution
-	gaussian_dist2 = new std::normal_distribution<double>(0, sigmaDtoD);	        // Set up mean and stddev for device-to-device weight update vairation
-	paramALTP = getParamA(NL_LTP + (*gaussian_dist2)(localGen)) * maxNumLevelLTP;	// Parameter A for LTP nonlinearity
-	paramALTD = getParamA(NL_LTD + (*gaussian_dist2)(localGen)) * maxNumLevelLTD;	// Parameter A for LTD nonlinearity
+	paramALTP = getParamA(NL_LTP + sigmaDtoD * RandomNormal(x, y, randomStream, RANDOM_D2D_NL_LTP)) * maxNumLevelLTP;	// Parameter A for LTP nonlinearity
+	paramALTD = getParamA(NL_LTD + sigmaDtoD * RandomNormal(x, y, randomStream, RANDOM_D2D_NL_LTD)) * maxNumLevelLTD;	// Parameter A for LTD nonlinearity
 
 	/* Cycle-to-cycle weight update variation */
 	sigmaCtoC = 0.005 * (maxConductance - minConductance);	                // Sigma of cycle-to-cycle weight update vairation: defined as the percentage of conductance range
-	gaussian_dist3 = new std::normal_distribution<double>(0, sigmaCtoC);    // Set up mean and stddev for cycle-to-cycle weight update vairation
 
 	/* Conductance range variation */
 	conductanceRangeVar = false;    // Consider variation of conductance range or not
 	maxConductanceVar = 0;          // Sigma of maxConductance variation (S)
 	minConductanceVar = 0;          // Sigma of minConductance variation (S)
-	gaussian_dist_maxConductance = new std::normal_distribution<double>(0, maxConductanceVar);
-	gaussian_dist_minConductance = new std::normal_distribution<double>(0, minConductanceVar);
 	if (conductanceRangeVar) {
-		maxConductance += (*gaussian_dist_maxConductance)(localGen);
-		minConductance += (*gaussian_dist_minConductance)(localGen);
+		maxConductance += maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		minConductance += minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 		if (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0 ) 
         {    // Conductance variation check
 			puts("[Error] Conductance variation check not passed. The variation may be too large.");
@@ -852,9 +836,8 @@ _3T1C:: _3T1C(int x, int y) {
 }
 
 double _3T1C::Read(double voltage) {
-	extern std::mt19937 gen;
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
@@ -911,9 +894,8 @@ void _3T1C::Write(double deltaWeightNormalized, double weight, double minWeight,
 }
 
     /* Cycle-to-cycle variation */
-	extern std::mt19937 gen;
 	if (sigmaCtoC && numPulse != 0) {
-		conductanceNew += (*gaussian_dist3)(gen) * sqrt(abs(numPulse));	// Absolute variation
+		conductanceNew += sigmaCtoC * RandomNormal(x, y, randomStream, RANDOM_WRITE_NOISE) * sqrt(abs(numPulse));	// Absolute variation
 	}
 	
 	if (conductanceNew > maxConductance) {
@@ -954,8 +936,8 @@ double _3T1C::GetMinReadCurrent(void) {
 
 HybridCell::HybridCell(int x, int y):
     LSBcell(x,y),
-    MSBcell_LTP(x,y),
-    MSBcell_LTD(x,y)
+    MSBcell_LTP(x,y,1),
+    MSBcell_LTD(x,y,2)
 {
     this -> x = x; 
     this -> y = y;
@@ -1158,35 +1140,29 @@ _2T1F::_2T1F(int x, int y) {
 	numPulse = 0;	         // Number of write pulses used in the most recent write operation (dynamic variable)
     xPulse=0;
     nonlinearWrite=true; 
+	nonlinearIV = false;	// FeFET is read through its access transistors, no I-V nonlinearity
 
 	readNoise = false;		// Consider read noise or not
 	sigmaReadNoise = 0;		// Sigma of read noise in gaussian distribution
-	gaussian_dist = new std::normal_distribution<double>(0, sigmaReadNoise);	// Set up mean and stddev for read noise
          
-	std::mt19937 localGen;	// It's OK not to use the external gen, since here the device-to-device vairation is a one-time deal
-	localGen.seed(std::time(0));
      
 	/* Device-to-device weight update variation */
 	NL_LTP = 0.5;	// LTP nonlinearity
 	NL_LTD = 0.5;	// LTD nonlinearity
 	sigmaDtoD = 0;	// Sigma of device-to-device weight update vairation in gaussian distribution
-	gaussian_dist2 = new std::normal_distribution<double>(0, sigmaDtoD);	// Set up mean and stddev for device-to-device weight update vairation
-	paramALTP = getParamA(NL_LTP + (*gaussian_dist2)(localGen)) * maxNumLevelLTP;	// Parameter A for LTP nonlinearity
-	paramALTD = getParamA(NL_LTD + (*gaussian_dist2)(localGen)) * maxNumLevelLTD;	// Parameter A for LTD nonlinearity
+	paramALTP = getParamA(NL_LTP + sigmaDtoD * RandomNormal(x, y, randomStream, RANDOM_D2D_NL_LTP)) * maxNumLevelLTP;	// Parameter A for LTP nonlinearity
+	paramALTD = getParamA(NL_LTD + sigmaDtoD * RandomNormal(x, y, randomStream, RANDOM_D2D_NL_LTD)) * maxNumLevelLTD;	// Parameter A for LTD nonlinearity
 
 	/* Cycle-to-cycle weight update variation */
 	sigmaCtoC = 0.005* (maxConductance - minConductance);	// Sigma of cycle-to-cycle weight update vairation: defined as the percentage of conductance range
-	gaussian_dist3 = new std::normal_distribution<double>(0, sigmaCtoC);    // Set up mean and stddev for cycle-to-cycle weight update vairation
 
 	/* Conductance range variation */
 	conductanceRangeVar = false;    // Consider variation of conductance range or not
 	maxConductanceVar = 0;          // Sigma of maxConductance variation (S)
 	minConductanceVar = 0;          // Sigma of minConductance variation (S)
-	gaussian_dist_maxConductance = new std::normal_distribution<double>(0, maxConductanceVar);
-	gaussian_dist_minConductance = new std::normal_distribution<double>(0, minConductanceVar);
 	if (conductanceRangeVar) {
-		maxConductance += (*gaussian_dist_maxConductance)(localGen);
-		minConductance += (*gaussian_dist_minConductance)(localGen);
+		maxConductance += maxConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MAX_CONDUCTANCE);
+		minConductance += minConductanceVar * RandomNormal(x, y, randomStream, RANDOM_D2D_MIN_CONDUCTANCE);
 		if (minConductance >= maxConductance || maxConductance < 0 || minConductance < 0 ) {    // Conductance variation check
 			puts("[Error] Conductance variation check not passed. The variation may be too large.");
 			exit(-1);
@@ -1195,9 +1171,8 @@ _2T1F::_2T1F(int x, int y) {
  }
  
 double _2T1F::Read(double voltage) {
-	extern std::mt19937 gen;
 		if (readNoise) {
-			return voltage * conductance * (1 + (*gaussian_dist)(gen));
+			return voltage * conductance * (1 + sigmaReadNoise * RandomNormal(x, y, randomStream, RANDOM_READ_NOISE));
 		} else {
 			return voltage * conductance;
 		}
@@ -1266,9 +1241,8 @@ void _2T1F::Write(double deltaWeightNormalized, double weight, double minWeight,
 	}
 
 	// Cycle-to-cycle variation
-	extern std::mt19937 gen;
 	if (sigmaCtoC && numPulse != 0) {
-		conductanceNew += (*gaussian_dist3)(gen) * sqrt(abs(numPulse));	// Absolute variation
+		conductanceNew += sigmaCtoC * RandomNormal(x, y, randomStream, RANDOM_WRITE_NOISE) * sqrt(abs(numPulse));	// Absolute variation
 	}
 	
 	if (conductanceNew > maxConductance) {
@@ -1290,23 +1264,11 @@ void _2T1F::Write(double deltaWeightNormalized, double weight, double minWeight,
 		writeLatencyLTP = 0;
 		writeLatencyLTD = 0;
 		writeVoltageSquareSum = 0;
-		double V = 0;
-		double PW = 0;
 		if (numPulse > 0) { // LTP
-			for (int i=0; i<numPulse; i++) {
-				V = VinitLTP + (xPulse+i) * VstepLTP;
-				PW = PWinitLTP + (xPulse+i) * PWstepLTP;
-				writeLatencyLTP += PW;
-				writeVoltageSquareSum += V * V;
-			}
+			IncrementalPulseSums(numPulse, xPulse, VinitLTP, VstepLTP, PWinitLTP, PWstepLTP, &writeLatencyLTP, &writeVoltageSquareSum);
 			writePulseWidthLTP = writeLatencyLTP / numPulse;
 		} else {    // LTD
-			for (int i=0; i<(-numPulse); i++) {
-				V = VinitLTD + (maxNumLevelLTD-xPulse+i) * VstepLTD;
-				PW = PWinitLTD + (maxNumLevelLTD-xPulse+i) * PWstepLTD;
-				writeLatencyLTD += PW;
-				writeVoltageSquareSum += V * V;
-			}
+			IncrementalPulseSums(-numPulse, maxNumLevelLTD-xPulse, VinitLTD, VstepLTD, PWinitLTD, PWstepLTD, &writeLatencyLTD, &writeVoltageSquareSum);
 			writePulseWidthLTD = writeLatencyLTD / (-numPulse);
 		}
 	}
@@ -1325,3 +1287,103 @@ void _2T1F::WriteEnergyCalculation(double wireCapCol)
       // deltaE = CV(t)^2-CV(0)^2
       writeEnergy += capacitance*fabs(Vnow*Vnow*-Vprev*Vprev);
 }
+
+/* Checkpoint state: the dynamic variables and the parameters drawn from device-to-device variation (see WriteCheckpoint in IO.cpp) */
+void eNVM::StreamState(FILE *fp, bool load) {
+	StreamValue(fp, load, conductance);
+	StreamValue(fp, load, conductancePrev);
+	StreamValue(fp, load, maxConductance);
+	StreamValue(fp, load, minConductance);
+	StreamValue(fp, load, readEnergy);
+	StreamValue(fp, load, writeEnergy);
+}
+
+void SRAM::StreamState(FILE *fp, bool load) {
+	StreamValue(fp, load, bit);
+	StreamValue(fp, load, bitPrev);
+	StreamValue(fp, load, readEnergy);
+	StreamValue(fp, load, writeEnergy);
+}
+
+void AnalogNVM::StreamState(FILE *fp, bool load) {
+	eNVM::StreamState(fp, load);
+	StreamValue(fp, load, numPulse);
+	StreamValue(fp, load, writeLatencyLTP);
+	StreamValue(fp, load, writeLatencyLTD);
+	StreamValue(fp, load, writePulseWidthLTP);
+	StreamValue(fp, load, writePulseWidthLTD);
+	StreamValue(fp, load, writeVoltageSquareSum);
+}
+
+void DigitalNVM::StreamState(FILE *fp, bool load) {
+	eNVM::StreamState(fp, load);
+	StreamValue(fp, load, bit);
+	StreamValue(fp, load, bitPrev);
+}
+
+void RealDevice::StreamState(FILE *fp, bool load) {
+	AnalogNVM::StreamState(fp, load);
+	StreamValue(fp, load, xPulse);
+	StreamValue(fp, load, paramALTP);
+	StreamValue(fp, load, paramBLTP);
+	StreamValue(fp, load, paramALTD);
+	StreamValue(fp, load, paramBLTD);
+}
+
+void MeasuredDevice::StreamState(FILE *fp, bool load) {
+	AnalogNVM::StreamState(fp, load);
+	StreamValue(fp, load, xPulse);
+}
+
+void _3T1C::StreamState(FILE *fp, bool load) {
+	StreamValue(fp, load, chargeStorage);
+	StreamValue(fp, load, chargeStoragePrev);
+	StreamValue(fp, load, voltageStorage);
+	StreamValue(fp, load, conductance);
+	StreamValue(fp, load, conductancePrev);
+	StreamValue(fp, load, maxConductance);
+	StreamValue(fp, load, minConductance);
+	StreamValue(fp, load, xPulse);
+	StreamValue(fp, load, numPulse);
+	StreamValue(fp, load, paramALTP);
+	StreamValue(fp, load, paramBLTP);
+	StreamValue(fp, load, paramALTD);
+	StreamValue(fp, load, paramBLTD);
+	StreamValue(fp, load, readEnergy);
+	StreamValue(fp, load, writeEnergy);
+	StreamValue(fp, load, writeLatencyLTP);
+	StreamValue(fp, load, writeLatencyLTD);
+	StreamValue(fp, load, writeVoltageSquareSum);
+}
+
+void HybridCell::StreamState(FILE *fp, bool load) {
+	LSBcell.StreamState(fp, load);
+	MSBcell_LTP.StreamState(fp, load);
+	MSBcell_LTD.StreamState(fp, load);
+	StreamValue(fp, load, conductance);
+	StreamValue(fp, load, conductancePrev);
+	StreamValue(fp, load, readEnergy);
+	StreamValue(fp, load, writeEnergy);
+	StreamValue(fp, load, transferReadEnergy);
+	StreamValue(fp, load, transferWriteEnergy);
+	StreamValue(fp, load, transferEnergy);
+}
+
+void _2T1F::StreamState(FILE *fp, bool load) {
+	AnalogNVM::StreamState(fp, load);
+	StreamValue(fp, load, conductanceMSB);
+	StreamValue(fp, load, prevMSBLevel);
+	StreamValue(fp, load, nowMSBLevel);
+	StreamValue(fp, load, transLTP);
+	StreamValue(fp, load, transLTD);
+	StreamValue(fp, load, chargeStorage);
+	StreamValue(fp, load, chargeStoragePrev);
+	StreamValue(fp, load, transEnergy);
+	StreamValue(fp, load, transLatency);
+	StreamValue(fp, load, transWriteEnergy);
+	StreamValue(fp, load, xPulse);
+	StreamValue(fp, load, paramALTP);
+	StreamValue(fp, load, paramBLTP);
+	StreamValue(fp, load, paramALTD);
+	StreamValue(fp, load, paramBLTD);
+}
@@ -39,15 +39,36 @@
 #ifndef CELL_H_
 #define CELL_H_
 
+#include <cstdio>
+#include <memory>
 #include <random>
 #include <vector>
 
+/* Write (load=false) or read (load=true) one value or an array of values of a binary checkpoint */
+template <class T>
+inline void StreamValue(FILE *fp, bool load, T &value) {
+	if (load)
+		fread(&value, sizeof(T), 1, fp);
+	else
+		fwrite(&value, sizeof(T), 1, fp);
+}
+
+template <class T>
+inline void StreamArray(FILE *fp, bool load, T *values, size_t count) {
+	if (load)
+		fread(values, sizeof(T), count, fp);
+	else
+		fwrite(values, sizeof(T), count, fp);
+}
+
 class Cell {
 public:
 	int x, y;	// Cell location: x (column) and y (row) start from index 0
+	int randomStream = 0;	// Separates the random streams of sub-cells sharing the same (x, y)
 	double heightInFeatureSize, widthInFeatureSize;	// Cell height/width in terms of feature size (F)
 	double area;	// Cell area (m^2)
 	virtual ~Cell() {}	// Add a virtual function to enable dynamic_cast
+	virtual void StreamState(FILE *, bool) {}	// Dynamic and device-to-device state of the cell in a checkpoint
 };
 
 class eNVM: public Cell {
@@ -75,13 +96,6 @@ public:
 	bool readNoise;	// Consider read noise or not
 	double sigmaReadNoise;	// Sigma of read noise in gaussian distribution
 	double NL;	// Nonlinearity in write scheme (the current ratio between Vw and Vw/2), assuming for the LTP side
-	std::normal_distribution<double> *gaussian_dist;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist2;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist3;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist4;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist5;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist_maxConductance;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist_minConductance;	// Normal distribution object
 	/* Need the 4 variables below if nonlinearIV=true */
 	double conductanceAtVwLTP;		// Conductance at the LTP write voltage
 	double conductanceAtVwLTD;		// Conductance at the LTD write voltage
@@ -90,6 +104,7 @@ public:
 	bool conductanceRangeVar;	// Consider variation of conductance range or not
 	double maxConductanceVar;	// Sigma of maxConductance variation (S)
 	double minConductanceVar;	// Sigma of minConductance variation (S)
+	void StreamState(FILE *fp, bool load);
 };
 
 class SRAM: public Cell {
@@ -108,6 +123,7 @@ public:
 	double Read(){}	// Currently not used
 	void Write(){}	// Currently not used
 	bool parallelRead;  // parallel read or not
+	void StreamState(FILE *fp, bool load);
 };
 
 class AnalogNVM: public eNVM {
@@ -144,6 +160,7 @@ public:
       else
           return readVoltage * avgMinConductance;}
 	void WriteEnergyCalculation(double wireCapCol);
+	void StreamState(FILE *fp, bool load);
 };
 
 class DigitalNVM: public eNVM {
@@ -157,6 +174,7 @@ public:
     bool isSTTMRAM;  // if it is STTMRAM, then, we can relax the cell area
     bool parallelRead; // if it is a parallel readout for STT-MRAM
 	void Write(int bitNew, double wireCapCol);
+	void StreamState(FILE *fp, bool load);
 };
 
 class IdealDevice: public AnalogNVM {
@@ -179,22 +197,27 @@ public:
 	double sigmaDtoD;	// Sigma of device-to-device variation on weight update nonliearity baseline
 	double sigmaCtoC;	// Sigma of cycle-to-cycle variation on weight update
 
-	RealDevice(int x, int y);
+	RealDevice(int x, int y, int randomStream=0);
 	double Read(double voltage);	// Return read current (A)
 	void Write(double deltaWeightNormalized, double weight, double minWeight, double maxWeight);
+	void UpdateParamB();	// Recompute paramBLTP and paramBLTD, needed whenever paramA or the conductance range changes
+	void StreamState(FILE *fp, bool load);
 };
 
+typedef std::shared_ptr<const std::vector<double> > MeasuredCurve;	// Measured conductance curve, shared by all the MeasuredDevice cells
+
 class MeasuredDevice: public AnalogNVM {
 public:
 	bool nonlinearWrite;	// Consider weight update nonlinearity or not
 	bool symLTPandLTD;	// True: use LTP conductance data for LTD
 	double xPulse;		// Conductance state in terms of the pulse number (doesn't need to be integer)
-	std::vector<double> dataConductanceLTP;	// LTP conductance data at different pulse number
-	std::vector<double> dataConductanceLTD;	// LTD conductance data at different pulse number
+	MeasuredCurve dataConductanceLTP;	// LTP conductance data at different pulse number
+	MeasuredCurve dataConductanceLTD;	// LTD conductance data at different pulse number
 
 	MeasuredDevice(int x, int y);
 	double Read(double voltage);	// Return read current (A)
 	void Write(double deltaWeightNormalized, double weight, double minWeight, double maxWeight);
+	void StreamState(FILE *fp, bool load);
 };
 
 // code added
@@ -255,13 +278,6 @@ class _3T1C : public Cell {
     /* device non-ideal effect */
     bool readNoise;	// Consider read noise or not
     double sigmaReadNoise;	// Sigma of read noise in gaussian distribution
-	std::normal_distribution<double> *gaussian_dist;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist2;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist3;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist4;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist5;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist_maxConductance;	// Normal distribution object
-	std::normal_distribution<double> *gaussian_dist_minConductance;	// Normal distribution object
 	bool conductanceRangeVar;	// Consider variation of conductance range or not
 	double maxConductanceVar;	// Sigma of maxConductance variation (S)
 	double minConductanceVar;	// Sigma of minConductance variation (S)
@@ -273,6 +289,7 @@ class _3T1C : public Cell {
 	double GetMinReadCurrent(void);
 
 	void WriteEnergyCalculation(double wireCapCol);    
+	void StreamState(FILE *fp, bool load);
 };
 
 
@@ -305,6 +322,7 @@ public:
   void Write(double deltaWeightNormalized, double weight, double minWeight, double maxWeight) ;
   void WriteEnergyCalculation(double wireCapCol); 
   void WeightTransfer(double weightMSB_LTP, double weightMSB_LTD, double minWeight, double maxWeight, double wireCapCol);
+  void StreamState(FILE *fp, bool load);
 };
 
 class _2T1F : public AnalogNVM{
@@ -369,7 +387,7 @@ class _2T1F : public AnalogNVM{
     void WriteEnergyCalculation(double wireCapCol);
    // void WeightTransfer(double newConductance, char* mode);
     void WeightTransfer(void);
-    
+    void StreamState(FILE *fp, bool load);
 };
 
 #endif
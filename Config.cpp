@@ -0,0 +1,249 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "Param.h"
+#include "Config.h"
+
+extern Param *param;
+
+/* Device parameters that each constructor in Cell.cpp reads through Param::DeviceParam */
+static const char *idealDeviceParams[] = {"maxConductance", "minConductance", "readVoltage", "readPulseWidth", "writeVoltageLTP", "writeVoltageLTD",
+		"writePulseWidthLTP", "writePulseWidthLTD", "maxNumLevelLTP", "maxNumLevelLTD", "cmosAccess", "resistanceAccess", "nonlinearIV", "NL",
+		"readNoise", "sigmaReadNoise", "conductanceRangeVar", "maxConductanceVar", "minConductanceVar"};
+static const char *realDeviceParams[] = {"maxConductance", "minConductance", "readVoltage", "readPulseWidth", "writeVoltageLTP", "writeVoltageLTD",
+		"writePulseWidthLTP", "writePulseWidthLTD", "maxNumLevelLTP", "maxNumLevelLTD", "cmosAccess", "resistanceAccess", "nonlinearIV", "NL",
+		"nonlinearWrite", "readNoise", "sigmaReadNoise", "NL_LTP", "NL_LTD", "sigmaDtoD", "sigmaCtoC", "conductanceRangeVar", "maxConductanceVar", "minConductanceVar"};
+static const char *measuredDeviceParams[] = {"readVoltage", "readPulseWidth", "writeVoltageLTP", "writeVoltageLTD", "writePulseWidthLTP", "writePulseWidthLTD",
+		"cmosAccess", "resistanceAccess", "nonlinearIV", "NL", "nonlinearWrite", "readNoise", "sigmaReadNoise"};
+static const char *digitalNVMParams[] = {"maxConductance", "minConductance", "readVoltage", "readPulseWidth", "writeVoltageLTP", "writeVoltageLTD",
+		"writePulseWidthLTP", "writePulseWidthLTD", "cmosAccess", "resistanceAccess", "nonlinearIV", "NL", "readNoise", "sigmaReadNoise",
+		"conductanceRangeVar", "maxConductanceVar", "minConductanceVar"};
+
+#define NAMES(names)	names, sizeof(names)/sizeof(names[0])
+
+struct DeviceParamNames {
+	const char *cellType;
+	const char **names;
+	int numNames;
+};
+static const DeviceParamNames deviceParamNames[] = {{"IdealDevice", NAMES(idealDeviceParams)}, {"RealDevice", NAMES(realDeviceParams)},
+		{"MeasuredDevice", NAMES(measuredDeviceParams)}, {"DigitalNVM", NAMES(digitalNVMParams)}};
+static const char *optimizationTypes[] = {"SGD", "Momentum", "RMSprop", "Adam"};
+
+static bool Contains(const char **names, int numNames, const std::string &name) {
+	for (int i=0; i<numNames; i++) {
+		if (name == names[i])
+			return true;
+	}
+	return false;
+}
+
+static int ParseInt(const char *key, const char *value) {
+	char *end;
+	long result = strtol(value, &end, 10);
+	if (!value[0] || *end) {
+		printf("[Error] %s needs an integer value, not \"%s\"\n", key, value);
+		exit(-1);
+	}
+	return result;
+}
+
+static double ParseDouble(const char *key, const char *value) {
+	if (!strcmp(value, "true"))
+		return 1;
+	if (!strcmp(value, "false"))
+		return 0;
+	char *end;
+	double result = strtod(value, &end);
+	if (!value[0] || *end) {
+		printf("[Error] %s needs a numeric value, not \"%s\"\n", key, value);
+		exit(-1);
+	}
+	return result;
+}
+
+static bool ParseBool(const char *key, const char *value) {
+	if (!strcmp(value, "true") || !strcmp(value, "1"))
+		return true;
+	if (!strcmp(value, "false") || !strcmp(value, "0"))
+		return false;
+	printf("[Error] %s needs true or false, not \"%s\"\n", key, value);
+	exit(-1);
+}
+
+#define INT_PARAM(name)		if (!strcmp(key, #name)) { param->name = ParseInt(key, value); return; }
+#define DOUBLE_PARAM(name)	if (!strcmp(key, #name)) { param->name = ParseDouble(key, value); return; }
+#define BOOL_PARAM(name)	if (!strcmp(key, #name)) { param->name = ParseBool(key, value); return; }
+#define STRING_PARAM(name)	if (!strcmp(key, #name)) { param->name = strdup(value); return; }
+
+void SetParameter(const char *key, const char *value) {
+	/* Device parameters: <cell type>.<name> */
+	const char *dot = strchr(key, '.');
+	if (dot) {
+		std::string cellType(key, dot - key), name(dot + 1);
+		bool known = false;
+		for (size_t i=0; i<sizeof(deviceParamNames)/sizeof(deviceParamNames[0]); i++) {
+			if (cellType == deviceParamNames[i].cellType)
+				known = Contains(deviceParamNames[i].names, deviceParamNames[i].numNames, name);
+		}
+		if (!known) {
+			printf("[Error] Unknown device parameter %s\n", key);
+			exit(-1);
+		}
+		param->deviceParams[key] = ParseDouble(key, value);
+		return;
+	}
+
+	/* Simulation */
+	INT_PARAM(numThreads)
+	INT_PARAM(seed)
+	STRING_PARAM(outputFile)
+	STRING_PARAM(sweepFile)
+	INT_PARAM(sweepJobs)
+	/* MNIST dataset */
+	INT_PARAM(numMnistTrainImages)
+	INT_PARAM(numMnistTestImages)
+	BOOL_PARAM(useDataCache)
+	BOOL_PARAM(mapDataCache)
+	/* Algorithm parameters */
+	INT_PARAM(numTrainImagesPerEpoch)
+	INT_PARAM(numTrainImagesPerBatch)
+	INT_PARAM(totalNumEpochs)
+	INT_PARAM(interNumEpochs)
+	BOOL_PARAM(sampledValidation)
+	DOUBLE_PARAM(validationTolerance)
+	DOUBLE_PARAM(validationZ)
+	INT_PARAM(validationChunk)
+	INT_PARAM(fullValidationInterval)
+	BOOL_PARAM(asyncValidation)
+	INT_PARAM(checkpointInterval)
+	STRING_PARAM(checkpointFile)
+	STRING_PARAM(resumeFile)
+	INT_PARAM(nInput)
+	INT_PARAM(nHide)
+	INT_PARAM(nOutput)
+	DOUBLE_PARAM(alpha1)
+	DOUBLE_PARAM(alpha2)
+	DOUBLE_PARAM(maxWeight)
+	DOUBLE_PARAM(minWeight)
+	if (!strcmp(key, "optimization_type")) {	// Train.cpp compares the pointer with the string literals
+		for (size_t i=0; i<sizeof(optimizationTypes)/sizeof(optimizationTypes[0]); i++) {
+			if (!strcmp(value, optimizationTypes[i])) {
+				param->optimization_type = (char *)optimizationTypes[i];
+				return;
+			}
+		}
+		printf("[Error] Unknown optimization_type %s\n", value);
+		exit(-1);
+	}
+	/* Hardware parameters */
+	BOOL_PARAM(useHardwareInTrainingFF)
+	BOOL_PARAM(useHardwareInTrainingWU)
+	BOOL_PARAM(useHardwareInTestingFF)
+	STRING_PARAM(deviceIH)
+	STRING_PARAM(deviceHO)
+	INT_PARAM(numBitInput)
+	INT_PARAM(numBitPartialSum)
+	INT_PARAM(numWeightBit)
+	DOUBLE_PARAM(BWthreshold)
+	DOUBLE_PARAM(Hthreshold)
+	INT_PARAM(numColMuxed)
+	INT_PARAM(numWriteColMuxed)
+	BOOL_PARAM(writeEnergyReport)
+	BOOL_PARAM(compactArray)
+	STRING_PARAM(measuredDataFile)
+	BOOL_PARAM(NeuroSimDynamicPerformance)
+	BOOL_PARAM(deferredNeuroSim)
+	BOOL_PARAM(relaxArrayCellHeight)
+	BOOL_PARAM(relaxArrayCellWidth)
+	DOUBLE_PARAM(arrayWireWidth)
+	INT_PARAM(processNode)
+	DOUBLE_PARAM(clkFreq)
+
+	printf("[Error] Unknown parameter %s\n", key);
+	exit(-1);
+}
+
+/* Split "key=value" around the first '=' and trim the white space of both sides */
+static void SetParameterFromText(char *text, const char *source) {
+	char *separator = strchr(text, '=');
+	if (!separator) {
+		printf("[Error] %s is not key=value\n", source);
+		exit(-1);
+	}
+	*separator = '\0';
+	char *key = text, *value = separator + 1;
+	while (*key == ' ' || *key == '\t') key++;
+	while (*value == ' ' || *value == '\t') value++;
+	for (char *end = separator; end > key && (end[-1] == ' ' || end[-1] == '\t'); end--) end[-1] = '\0';
+	for (char *end = value + strlen(value); end > value && strchr(" \t\r\n", end[-1]); end--) end[-1] = '\0';
+	SetParameter(key, value);
+}
+
+void ReadConfigurationFile(const char *fileName) {
+	FILE *fp = fopen(fileName, "r");
+	if (!fp) {
+		printf("%s cannot be found!\n", fileName);
+		exit(-1);
+	}
+	char line[1024], source[1100];
+	for (int numLine=1; fgets(line, sizeof(line), fp); numLine++) {
+		char *comment = strchr(line, '#');
+		if (comment)
+			*comment = '\0';
+		if (strspn(line, " \t\r\n") == strlen(line))	// Blank line
+			continue;
+		sprintf(source, "Line %d of %s", numLine, fileName);
+		SetParameterFromText(line, source);
+	}
+	fclose(fp);
+}
+
+void ReadConfiguration(int argc, char **argv) {
+	for (int i=1; i<argc; i++) {
+		if (strchr(argv[i], '='))
+			SetParameterFromText(argv[i], argv[i]);
+		else
+			ReadConfigurationFile(argv[i]);
+	}
+	param->Update();
+}
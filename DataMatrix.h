@@ -0,0 +1,117 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#ifndef DATAMATRIX_H_
+#define DATAMATRIX_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+/* Contiguous row-major matrix used for the datasets. Rows are padded to a 64-byte boundary so that
+   every row starts aligned, and the storage can either be allocated or mapped from a binary file. */
+template <class T>
+class DataMatrix {
+public:
+	T *data;
+	int numRows, numCols;
+	int stride;	// # of elements between the starts of two consecutive rows
+	void *mapping;	// Start of the mmap region when the data is backed by a file (NULL otherwise)
+	size_t mappingSize;
+
+	DataMatrix(int numRows, int numCols) {
+		mapping = NULL;
+		mappingSize = 0;
+		Allocate(numRows, numCols);
+	}
+	~DataMatrix() {
+		Release();
+	}
+
+	/* Replace the contents by a zeroed matrix of the new size */
+	void Resize(int numRows, int numCols) {
+		if (numRows == this->numRows && numCols == this->numCols)
+			return;
+		Release();
+		Allocate(numRows, numCols);
+	}
+
+	T *operator[](int row) { return data + (size_t)row * stride; }
+	const T *operator[](int row) const { return data + (size_t)row * stride; }
+	size_t Bytes() const { return (size_t)numRows * stride * sizeof(T); }
+
+	/* Use Bytes() bytes of the file at offset (must be page aligned) as the storage, copy-on-write */
+	bool Map(int fd, off_t offset) {
+		void *addr = mmap(NULL, Bytes(), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, offset);
+		if (addr == MAP_FAILED)
+			return false;
+		Release();
+		data = (T *)addr;
+		mapping = addr;
+		mappingSize = Bytes();
+		return true;
+	}
+
+private:
+	DataMatrix(const DataMatrix &);
+	DataMatrix &operator=(const DataMatrix &);
+
+	void Allocate(int numRows, int numCols) {
+		this->numRows = numRows;
+		this->numCols = numCols;
+		stride = (numCols * sizeof(T) + 63) / 64 * 64 / sizeof(T);
+		if (posix_memalign((void **)&data, 64, Bytes()) != 0) {
+			puts("Not enough memory for the dataset");
+			exit(-1);
+		}
+		memset(data, 0, Bytes());
+	}
+
+	void Release() {
+		if (mapping)
+			munmap(mapping, mappingSize);
+		else
+			free(data);
+		data = NULL;
+		mapping = NULL;
+	}
+};
+
+#endif
@@ -42,26 +42,26 @@
 Param *param = new Param(); // Parameter set
 
 /* Inputs of training set */
-std::vector< std::vector<double> >
-Input(param->numMnistTrainImages, std::vector<double>(param->nInput));
+DataMatrix<double>
+Input(param->numMnistTrainImages, param->nInput);
 /* Outputs of training set */
-std::vector< std::vector<double> >
-Output(param->numMnistTrainImages, std::vector<double>(param->nOutput));
+DataMatrix<double>
+Output(param->numMnistTrainImages, param->nOutput);
 
 /* Weights from input to hidden layer */
-std::vector< std::vector<double> >
-weight1(param->nHide, std::vector<double>(param->nInput));
+DataMatrix<double>
+weight1(param->nHide, param->nInput);
 /* Weights from hidden layer to output layer */
-std::vector< std::vector<double> >
-weight2(param->nOutput, std::vector<double>(param->nHide));
+DataMatrix<double>
+weight2(param->nOutput, param->nHide);
 
 /* Weight change of weight1 */
-std::vector< std::vector<double> >
-deltaWeight1(param->nHide, std::vector<double>(param->nInput));
+DataMatrix<double>
+deltaWeight1(param->nHide, param->nInput);
 
 /* Weight change of weight2 */
-std::vector< std::vector<double> >
-deltaWeight2(param->nOutput, std::vector<double>(param->nHide));
+DataMatrix<double>
+deltaWeight2(param->nOutput, param->nHide);
 
 /*the variables to track the ΔW*/
 std::vector< std::vector<double> >
@@ -75,18 +75,21 @@ std::vector< std::vector<double> >
 totalDeltaWeight2_abs(param->nOutput, std::vector<double>(param->nHide));
 
 /* Inputs of testing set */
-std::vector< std::vector<double> >
-testInput(param->numMnistTestImages, std::vector<double>(param->nInput));
+DataMatrix<double>
+testInput(param->numMnistTestImages, param->nInput);
 /* Outputs of testing set */
-std::vector< std::vector<double> >
-testOutput(param->numMnistTestImages, std::vector<double>(param->nOutput));
+DataMatrix<double>
+testOutput(param->numMnistTestImages, param->nOutput);
 
 /* Digitized inputs of training set (an integer between 0 to 2^numBitInput-1) */
-std::vector< std::vector<int> >
-dInput(param->numMnistTrainImages, std::vector<int>(param->nInput));
+DataMatrix<int>
+dInput(param->numMnistTrainImages, param->nInput);
 /* Digitized inputs of testing set (an integer between 0 to 2^numBitInput-1) */
-std::vector< std::vector<int> >
-dTestInput(param->numMnistTestImages, std::vector<int>(param->nInput));
+DataMatrix<int>
+dTestInput(param->numMnistTestImages, param->nInput);
+/* Bit planes and active rows of dInput and dTestInput */
+InputPlane trainInputPlane;
+InputPlane testInputPlane;
 
 // the arrays for optimization
 std::vector< std::vector<double> > 
@@ -105,14 +108,17 @@ momentumPrev2(param->nOutput, std::vector<double>(param->nHide));
 
 /* # of correct prediction */
 int correct = 0;
+/* # of test images evaluated by the last Validate() and the half width of its accuracy confidence interval (0 if all were evaluated) */
+int numValidated = 0;
+double validationHalfWidth = 0;
 
 /* Synaptic array between input and hidden layer */
 Array *arrayIH = new Array(param->nHide, param->nInput, param->arrayWireWidth);
 /* Synaptic array between hidden and output layer */
 Array *arrayHO = new Array(param->nOutput, param->nHide, param->arrayWireWidth);
 
-/* Random number generator engine */
-std::mt19937 gen;
+/* Seed and position of the counter-based random streams (see RNG.h) */
+RandomContext randomContext;
 
 /* NeuroSim */
 SubArray *subArrayIH;   // NeuroSim synaptic core for arrayIH
@@ -137,3 +143,6 @@ Mux muxHO(inputParameterHO, techHO, cellHO);
 RowDecoder muxDecoderHO(inputParameterHO, techHO, cellHO);
 DFF dffHO(inputParameterHO, techHO, cellHO);
 Subtractor subtractorHO(inputParameterHO, techHO, cellHO);
+/* Recorded activity of subArrayIH and subArrayHO (param->deferredNeuroSim) */
+NeuroSimActivity activityIH(param->nInput * param->numBitInput);
+NeuroSimActivity activityHO(param->nHide * param->numBitInput);
@@ -0,0 +1,146 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#include <algorithm>
+#include <vector>
+#include "Gemm.h"
+#ifdef USE_CBLAS
+#include <cblas.h>
+#endif
+
+void MatVec(const DataMatrix<double> &A, const double *x, double *y) {
+	int m = A.numRows, n = A.numCols;
+#ifdef USE_CBLAS
+	cblas_dgemv(CblasRowMajor, CblasNoTrans, m, n, 1.0, A.data, A.stride, x, 1, 0.0, y, 1);
+#else
+	/* Four rows per pass share the loads of x and give four independent sums to the FPU */
+	#pragma omp parallel for
+	for (int j=0; j<m; j+=4) {
+		if (j + 4 <= m) {
+			const double *a0 = A[j], *a1 = A[j+1], *a2 = A[j+2], *a3 = A[j+3];
+			double y0 = 0, y1 = 0, y2 = 0, y3 = 0;
+			for (int k=0; k<n; k++) {
+				y0 += x[k] * a0[k];
+				y1 += x[k] * a1[k];
+				y2 += x[k] * a2[k];
+				y3 += x[k] * a3[k];
+			}
+			y[j] = y0; y[j+1] = y1; y[j+2] = y2; y[j+3] = y3;
+		} else {
+			for (int jj=j; jj<m; jj++) {
+				double sum = 0;
+				for (int k=0; k<n; k++) {
+					sum += x[k] * A[jj][k];
+				}
+				y[jj] = sum;
+			}
+		}
+	}
+#endif
+}
+
+void MatVecTransposed(const DataMatrix<double> &A, const double *x, const double *scale, double *y) {
+	int n = A.numCols;
+	std::fill_n(y, n, 0);
+	for (int k=0; k<A.numRows; k++) {	// Rows of A are contiguous, so the loop over j vectorizes
+		const double *a = A[k];
+		double xk = x[k];
+		#pragma omp simd
+		for (int j=0; j<n; j++) {
+			y[j] += scale[j] * a[j] * xk;
+		}
+	}
+}
+
+void MatMulTransposed(const DataMatrix<double> &X, int firstRow, int numRows, const DataMatrix<double> &A, DataMatrix<double> &Y) {
+	int m = A.numRows, n = A.numCols;
+#ifdef USE_CBLAS
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, numRows, m, n, 1.0, X[firstRow], X.stride, A.data, A.stride, 0.0, Y.data, Y.stride);
+#else
+	/* Pack A^T in panels of panelSize outputs ([panel][k][c], zero padded) so that the inner loop runs over
+	   contiguous outputs and every panel is reused by all the rows of X */
+	const int panelSize = 8;
+	int numPanels = (m + panelSize - 1) / panelSize;
+	std::vector<double> packed((size_t)numPanels * n * panelSize, 0);
+	for (int j=0; j<m; j++) {
+		double *p = &packed[(size_t)(j / panelSize) * n * panelSize + j % panelSize];
+		for (int k=0; k<n; k++) {
+			p[k * panelSize] = A[j][k];
+		}
+	}
+	#pragma omp parallel for
+	for (int r=0; r<numRows; r++) {
+		const double *xr = X[firstRow + r];
+		double *yr = Y[r];
+		for (int panel=0; panel<numPanels; panel++) {
+			const double *p = &packed[(size_t)panel * n * panelSize];
+			double sum[panelSize] = {0};
+			for (int k=0; k<n; k++) {
+				#pragma omp simd
+				for (int c=0; c<panelSize; c++) {
+					sum[c] += xr[k] * p[k * panelSize + c];
+				}
+			}
+			for (int c=0; c<panelSize && panel*panelSize + c<m; c++) {
+				yr[panel*panelSize + c] = sum[c];
+			}
+		}
+	}
+#endif
+}
+
+void OuterProductUpdate(double alpha, const double *s, const double *x, DataMatrix<double> &deltaWeight, DataMatrix<double> &weight, double minWeight, double maxWeight) {
+	#pragma omp parallel for
+	for (int j=0; j<weight.numRows; j++) {
+		double as = alpha * s[j];
+		double *delta = deltaWeight[j], *w = weight[j];
+		#pragma omp simd
+		for (int k=0; k<weight.numCols; k++) {
+			delta[k] = as * x[k];
+			double wNew = w[k] + delta[k];
+			if (wNew > maxWeight) {
+				delta[k] -= wNew - maxWeight;
+				wNew = maxWeight;
+			} else if (wNew < minWeight) {
+				delta[k] += minWeight - wNew;
+				wNew = minWeight;
+			}
+			w[k] = wNew;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#ifndef GEMM_H_
+#define GEMM_H_
+
+#include "DataMatrix.h"
+
+/* Dense kernels of the algorithm (software) path on the row-major weight matrices. Each output is summed over k
+   in the same order as the plain loops, so the results are bit-identical to them; the speed comes from blocking
+   over independent outputs. With -DUSE_CBLAS, MatVec and MatMulTransposed call a CBLAS library instead,
+   whose summation order may differ in the last bits. */
+void MatVec(const DataMatrix<double> &A, const double *x, double *y);	// y[j] = sum_k A[j][k]*x[k]
+void MatVecTransposed(const DataMatrix<double> &A, const double *x, const double *scale, double *y);	// y[j] = sum_k scale[j]*A[k][j]*x[k]
+void MatMulTransposed(const DataMatrix<double> &X, int firstRow, int numRows, const DataMatrix<double> &A, DataMatrix<double> &Y);	// Y[r][j] = sum_k X[firstRow+r][k]*A[j][k]
+/* deltaWeight = alpha*s*x^T, added to weight and clipped to [minWeight, maxWeight], deltaWeight keeps the applied change */
+void OuterProductUpdate(double alpha, const double *s, const double *x, DataMatrix<double> &deltaWeight, DataMatrix<double> &weight, double minWeight, double maxWeight);
+
+#endif
@@ -38,35 +38,167 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <iostream>
 #include <vector>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "formula.h"
 #include "Param.h"
 #include "Cell.h"
 #include "Array.h"
+#include "DataMatrix.h"
+#include "NeuroSim.h"
+#include "RNG.h"
 
 extern Param *param;
 extern Array *arrayIH;
 extern Array *arrayHO;
-extern std::vector< std::vector<double> > Input;
-extern std::vector< std::vector<int> > dInput;
-extern std::vector< std::vector<double> > testInput;
-extern std::vector< std::vector<int> > dTestInput;
-extern std::vector< std::vector<double> > Output;
-extern std::vector< std::vector<double> > testOutput;
-
-extern std::vector< std::vector<double> > weight1;
-extern std::vector< std::vector<double> > weight2;
-extern std::vector< std::vector<double> > deltaWeight1;
-extern std::vector< std::vector<double> > deltaWeight2;
+extern DataMatrix<double> Input;
+extern DataMatrix<int> dInput;
+extern DataMatrix<double> testInput;
+extern DataMatrix<int> dTestInput;
+extern DataMatrix<double> Output;
+extern DataMatrix<double> testOutput;
+
+extern DataMatrix<double> weight1;
+extern DataMatrix<double> weight2;
+extern DataMatrix<double> deltaWeight1;
+extern DataMatrix<double> deltaWeight2;
 extern std::vector<std::vector<double> >  totalDeltaWeight1;
 extern std::vector<std::vector<double> >  totalDeltaWeight1_abs;
 extern std::vector<std::vector<double> >  totalDeltaWeight2;
 extern std::vector<std::vector<double> >  totalDeltaWeight2_abs;
+extern std::vector<std::vector<double> >  gradSquarePrev1;
+extern std::vector<std::vector<double> >  gradSquarePrev2;
+extern std::vector<std::vector<double> >  momentumPrev1;
+extern std::vector<std::vector<double> >  momentumPrev2;
+extern std::vector<std::vector<double> >  gradSum1;
+extern std::vector<std::vector<double> >  gradSum2;
+extern double totalWeightUpdate;
+extern double totalNumPulse;
+extern SubArray *subArrayIH;
+extern SubArray *subArrayHO;
+
+/* Binary dataset cache (written next to the patch file as <patch file>.cache) */
+#define DATA_CACHE_MAGIC	"NSDATA"
+#define DATA_CACHE_VERSION	2
+
+struct DataCacheHeader {
+	char magic[8];
+	int version;
+	int numBitInput;	// Input digitization the cached tensors were made with
+	double BWthreshold;
+	int nInput, nOutput;
+	int numImages;
+	long long patchFileSize, patchFileTime;	// Source files the cache was built from
+	long long labelFileSize, labelFileTime;
+};
+
+static void FillDataCacheHeader(DataCacheHeader *header, const char *patchFileName, const char *labelFileName, int numImages) {
+	struct stat patchStat, labelStat;
+	memset(header, 0, sizeof(DataCacheHeader));
+	strcpy(header->magic, DATA_CACHE_MAGIC);
+	header->version = DATA_CACHE_VERSION;
+	header->numBitInput = param->numBitInput;
+	header->BWthreshold = param->BWthreshold;
+	header->nInput = param->nInput;
+	header->nOutput = param->nOutput;
+	header->numImages = numImages;
+	if (stat(patchFileName, &patchStat) == 0) {
+		header->patchFileSize = patchStat.st_size;
+		header->patchFileTime = patchStat.st_mtime;
+	}
+	if (stat(labelFileName, &labelStat) == 0) {
+		header->labelFileSize = labelStat.st_size;
+		header->labelFileTime = labelStat.st_mtime;
+	}
+}
+
+/* Each tensor starts at a multiple of this offset so that it can be mapped directly */
+#define DATA_CACHE_ALIGNMENT	65536
+
+static long long AlignDataCacheOffset(long long offset) {
+	return (offset + DATA_CACHE_ALIGNMENT - 1) / DATA_CACHE_ALIGNMENT * DATA_CACHE_ALIGNMENT;
+}
+
+/* Load the truncated dataset from the cache, return false if the cache is missing or stale */
+static bool ReadDataCache(const char *cacheFileName, const char *patchFileName, const char *labelFileName, int numImages,
+		DataMatrix<double> &input, DataMatrix<int> &dInput, DataMatrix<double> &output) {
+	FILE *fp_cache = fopen(cacheFileName, "rb");
+	if (!fp_cache)
+		return false;
+
+	DataCacheHeader header, expected;
+	FillDataCacheHeader(&expected, patchFileName, labelFileName, numImages);
+	if (fread(&header, sizeof(DataCacheHeader), 1, fp_cache) != 1 || memcmp(&header, &expected, sizeof(DataCacheHeader)) != 0) {
+		std::cout << cacheFileName << " is stale and will be rebuilt\n";
+		fclose(fp_cache);
+		return false;
+	}
+
+	long long offsetInput = AlignDataCacheOffset(sizeof(DataCacheHeader));
+	long long offsetDInput = AlignDataCacheOffset(offsetInput + input.Bytes());
+	long long offsetOutput = AlignDataCacheOffset(offsetDInput + dInput.Bytes());
+	struct stat cacheStat;
+	if (fstat(fileno(fp_cache), &cacheStat) != 0 || cacheStat.st_size < offsetOutput + (long long)output.Bytes()) {
+		std::cout << cacheFileName << " is truncated and will be rebuilt\n";
+		fclose(fp_cache);
+		return false;
+	}
+
+	bool valid;
+	if (param->mapDataCache && sysconf(_SC_PAGESIZE) <= DATA_CACHE_ALIGNMENT) {
+		int fd = fileno(fp_cache);
+		valid = input.Map(fd, offsetInput) && dInput.Map(fd, offsetDInput) && output.Map(fd, offsetOutput);
+	} else {
+		valid = fseek(fp_cache, offsetInput, SEEK_SET) == 0 && fread(input.data, 1, input.Bytes(), fp_cache) == input.Bytes()
+				&& fseek(fp_cache, offsetDInput, SEEK_SET) == 0 && fread(dInput.data, 1, dInput.Bytes(), fp_cache) == dInput.Bytes()
+				&& fseek(fp_cache, offsetOutput, SEEK_SET) == 0 && fread(output.data, 1, output.Bytes(), fp_cache) == output.Bytes();
+	}
+	fclose(fp_cache);	// The mappings stay valid after the file is closed
+	if (!valid)
+		std::cout << cacheFileName << " cannot be loaded and will be rebuilt\n";
+	return valid;
+}
+
+static void WriteDataCache(const char *cacheFileName, const char *patchFileName, const char *labelFileName, int numImages,
+		DataMatrix<double> &input, DataMatrix<int> &dInput, DataMatrix<double> &output) {
+	/* Write to a temporary file first so that a concurrent run never sees a partial cache */
+	char tempFileName[1024];
+	sprintf(tempFileName, "%s.tmp%d", cacheFileName, (int)getpid());
+	FILE *fp_cache = fopen(tempFileName, "wb");
+	if (!fp_cache) {
+		std::cout << cacheFileName << " cannot be written, continue without the dataset cache\n";
+		return;
+	}
+
+	DataCacheHeader header;
+	FillDataCacheHeader(&header, patchFileName, labelFileName, numImages);
+	long long offsetInput = AlignDataCacheOffset(sizeof(DataCacheHeader));
+	long long offsetDInput = AlignDataCacheOffset(offsetInput + input.Bytes());
+	long long offsetOutput = AlignDataCacheOffset(offsetDInput + dInput.Bytes());
+	bool valid = fwrite(&header, sizeof(DataCacheHeader), 1, fp_cache) == 1
+			&& fseek(fp_cache, offsetInput, SEEK_SET) == 0 && fwrite(input.data, 1, input.Bytes(), fp_cache) == input.Bytes()
+			&& fseek(fp_cache, offsetDInput, SEEK_SET) == 0 && fwrite(dInput.data, 1, dInput.Bytes(), fp_cache) == dInput.Bytes()
+			&& fseek(fp_cache, offsetOutput, SEEK_SET) == 0 && fwrite(output.data, 1, output.Bytes(), fp_cache) == output.Bytes();
+	valid = (fclose(fp_cache) == 0) && valid;
+	if (!valid || rename(tempFileName, cacheFileName) != 0) {
+		std::cout << cacheFileName << " cannot be written, continue without the dataset cache\n";
+		remove(tempFileName);
+	}
+}
 
 /* Read trainging data from file */
 void ReadTrainingDataFromFile(const char *trainPatchFileName, const char *trainLabelFileName) {
+	char cacheFileName[1024];
+	sprintf(cacheFileName, "%s.cache", trainPatchFileName);
+	if (param->useDataCache && ReadDataCache(cacheFileName, trainPatchFileName, trainLabelFileName, param->numMnistTrainImages, Input, dInput, Output))
+		return;
+
 	FILE *fp_patch = fopen(trainPatchFileName, "r");
 	FILE *fp_label = fopen(trainLabelFileName, "r");
 
@@ -100,10 +232,18 @@ void ReadTrainingDataFromFile(const char *trainPatchFileName, const char *trainL
 	}
 	fclose(fp_patch);
 	fclose(fp_label);
+
+	if (param->useDataCache)
+		WriteDataCache(cacheFileName, trainPatchFileName, trainLabelFileName, param->numMnistTrainImages, Input, dInput, Output);
 }
 
 /* Read testing data from file */
 void ReadTestingDataFromFile(const char *testPatchFileName, const char *testLabelFileName) {
+	char cacheFileName[1024];
+	sprintf(cacheFileName, "%s.cache", testPatchFileName);
+	if (param->useDataCache && ReadDataCache(cacheFileName, testPatchFileName, testLabelFileName, param->numMnistTestImages, testInput, dTestInput, testOutput))
+		return;
+
 	FILE *fp_patch = fopen(testPatchFileName, "r");
 	FILE *fp_label = fopen(testLabelFileName, "r");
 
@@ -137,6 +277,9 @@ void ReadTestingDataFromFile(const char *testPatchFileName, const char *testLabe
 
 	fclose(fp_patch);
 	fclose(fp_label);
+
+	if (param->useDataCache)
+		WriteDataCache(cacheFileName, testPatchFileName, testLabelFileName, param->numMnistTestImages, testInput, dTestInput, testOutput);
 }
 
 /* Print weight to file */
@@ -173,3 +316,182 @@ void PrintWeightToFile(const char *str) {
 	fclose(fp_dw2);
 }
 
+/* Measured conductance curves of MeasuredDevice. Every line is "LTP <conductance>" or "LTD <conductance>" (S) in the order
+   of the pulse number, and lines starting with # are comments. Without LTD points the LTP data is also used for LTD.
+   The file is parsed only once, see LoadMeasuredCurves in Cell.cpp */
+void ReadMeasuredDataFromFile(const char *fileName, std::vector<double> &dataConductanceLTP, std::vector<double> &dataConductanceLTD) {
+	FILE *fp = fopen(fileName, "r");
+	if (!fp) {
+		std::cout << fileName << " cannot be found!\n";
+		exit(-1);
+	}
+	dataConductanceLTP.clear();
+	dataConductanceLTD.clear();
+	char line[1024], curve[16];
+	double conductance;
+	for (int lineNumber=1; fgets(line, sizeof(line), fp); lineNumber++) {
+		if (sscanf(line, " %15s", curve) != 1 || curve[0] == '#')	// Blank line or comment
+			continue;
+		if (sscanf(line, " %15s %lf", curve, &conductance) != 2 || (strcmp(curve, "LTP") != 0 && strcmp(curve, "LTD") != 0)) {
+			std::cout << fileName << ":" << lineNumber << ": expected \"LTP <conductance>\" or \"LTD <conductance>\"\n";
+			exit(-1);
+		}
+		if (strcmp(curve, "LTP") == 0)
+			dataConductanceLTP.push_back(conductance);
+		else
+			dataConductanceLTD.push_back(conductance);
+	}
+	fclose(fp);
+	if (dataConductanceLTP.size() < 2 || dataConductanceLTD.size() == 1) {
+		std::cout << fileName << " needs at least two conductance points per curve\n";
+		exit(-1);
+	}
+}
+
+/* Binary checkpoint of the training state. It can only be loaded into a simulator built with the same network and devices,
+   and configured with the same training parameters */
+#define CHECKPOINT_MAGIC	"NSCKPT"
+#define CHECKPOINT_VERSION	2
+
+struct CheckpointHeader {
+	char magic[8];
+	int version;
+	int nInput, nHide, nOutput;
+	int cellKindIH, cellKindHO;
+	int compactIH, compactHO;
+	int numCellPerSynapseIH, numCellPerSynapseHO;
+	unsigned int seed;
+	unsigned long long configurationHash;	// See CheckpointConfigurationHash
+	int epoch;	// # of validations done when the checkpoint was written
+	long long numRandomDraws;	// # of rand() calls since srand(param->seed) in main
+};
+
+/* FNV-1a hash of the parameters that the training state and the rand() sequence depend on, including the device
+   parameter overrides. The run length, thread count, validation and output settings may change on a resume */
+static unsigned long long CheckpointConfigurationHash() {
+	char text[1024];
+	snprintf(text, sizeof(text), "%d %d %d %d %.17g %.17g %.17g %.17g %s %d %d %d %d %d %.17g %.17g %d %d %s",
+			param->numMnistTrainImages, param->numTrainImagesPerEpoch, param->numTrainImagesPerBatch, param->interNumEpochs,
+			param->alpha1, param->alpha2, param->maxWeight, param->minWeight, param->optimization_type,
+			param->useHardwareInTrainingFF, param->useHardwareInTrainingWU, param->numBitInput, param->numBitPartialSum,
+			param->numWeightBit, param->BWthreshold, param->Hthreshold, param->numColMuxed, param->numWriteColMuxed,
+			param->measuredDataFile);
+	std::string configuration(text);
+	for (std::map<std::string, double>::iterator it=param->deviceParams.begin(); it!=param->deviceParams.end(); it++) {
+		snprintf(text, sizeof(text), " %s=%.17g", it->first.c_str(), it->second);
+		configuration += text;
+	}
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t i=0; i<configuration.size(); i++) {
+		hash = (hash ^ (unsigned char)configuration[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+static void FillCheckpointHeader(CheckpointHeader *header, int epoch, long long numRandomDraws) {
+	memset(header, 0, sizeof(CheckpointHeader));
+	strcpy(header->magic, CHECKPOINT_MAGIC);
+	header->version = CHECKPOINT_VERSION;
+	header->nInput = param->nInput;
+	header->nHide = param->nHide;
+	header->nOutput = param->nOutput;
+	header->cellKindIH = arrayIH->cellKind;
+	header->cellKindHO = arrayHO->cellKind;
+	header->compactIH = arrayIH->compact;
+	header->compactHO = arrayHO->compact;
+	header->numCellPerSynapseIH = arrayIH->numCellPerSynapse;
+	header->numCellPerSynapseHO = arrayHO->numCellPerSynapse;
+	header->seed = randomContext.seed;
+	header->configurationHash = CheckpointConfigurationHash();
+	header->epoch = epoch;
+	header->numRandomDraws = numRandomDraws;
+}
+
+static void StreamMatrix(FILE *fp, bool load, std::vector<std::vector<double> > &matrix) {
+	for (size_t i=0; i<matrix.size(); i++)
+		StreamArray(fp, load, &matrix[i][0], matrix[i].size());
+}
+
+static void StreamSubArray(FILE *fp, bool load, SubArray *subArray) {
+	StreamValue(fp, load, subArray->readLatency);
+	StreamValue(fp, load, subArray->writeLatency);
+	StreamValue(fp, load, subArray->readDynamicEnergy);
+	StreamValue(fp, load, subArray->writeDynamicEnergy);
+	StreamValue(fp, load, subArray->transferReadLatency);
+	StreamValue(fp, load, subArray->transferWriteLatency);
+	StreamValue(fp, load, subArray->transferLatency);
+	StreamValue(fp, load, subArray->transferReadDynamicEnergy);
+	StreamValue(fp, load, subArray->transferWriteDynamicEnergy);
+	StreamValue(fp, load, subArray->transferDynamicEnergy);
+}
+
+void StreamCheckpoint(FILE *fp, bool load) {
+	StreamArray(fp, load, weight1.data, weight1.Bytes() / sizeof(double));
+	StreamArray(fp, load, weight2.data, weight2.Bytes() / sizeof(double));
+	StreamMatrix(fp, load, gradSquarePrev1);
+	StreamMatrix(fp, load, gradSquarePrev2);
+	StreamMatrix(fp, load, momentumPrev1);
+	StreamMatrix(fp, load, momentumPrev2);
+	StreamMatrix(fp, load, gradSum1);
+	StreamMatrix(fp, load, gradSum2);
+	StreamMatrix(fp, load, totalDeltaWeight1);
+	StreamMatrix(fp, load, totalDeltaWeight1_abs);
+	StreamMatrix(fp, load, totalDeltaWeight2);
+	StreamMatrix(fp, load, totalDeltaWeight2_abs);
+	StreamValue(fp, load, totalWeightUpdate);
+	StreamValue(fp, load, totalNumPulse);
+	arrayIH->StreamState(fp, load);
+	arrayHO->StreamState(fp, load);
+	StreamSubArray(fp, load, subArrayIH);
+	StreamSubArray(fp, load, subArrayHO);
+}
+
+/* Write the checkpoint after epoch validations, numRandomDraws is the position in the rand() sequence */
+void WriteCheckpoint(const char *fileName, int epoch, long long numRandomDraws) {
+	char tempFileName[1024];
+	sprintf(tempFileName, "%s.tmp%d", fileName, (int)getpid());
+	FILE *fp = fopen(tempFileName, "wb");
+	if (!fp) {
+		std::cout << fileName << " cannot be written, continue without the checkpoint\n";
+		return;
+	}
+
+	CheckpointHeader header;
+	FillCheckpointHeader(&header, epoch, numRandomDraws);
+	fwrite(&header, sizeof(CheckpointHeader), 1, fp);
+	StreamCheckpoint(fp, false);
+	bool valid = !ferror(fp);
+	valid = (fclose(fp) == 0) && valid;
+	if (!valid || rename(tempFileName, fileName) != 0) {
+		std::cout << fileName << " cannot be written, continue without the checkpoint\n";
+		remove(tempFileName);
+	}
+}
+
+/* Load the checkpoint into the initialized simulator, return the # of validations it was written after */
+int ReadCheckpoint(const char *fileName, long long *numRandomDraws) {
+	FILE *fp = fopen(fileName, "rb");
+	if (!fp) {
+		std::cout << fileName << " cannot be found!\n";
+		exit(-1);
+	}
+
+	CheckpointHeader header, expected;
+	if (fread(&header, sizeof(CheckpointHeader), 1, fp) != 1) {
+		std::cout << fileName << " is not a checkpoint\n";
+		exit(-1);
+	}
+	FillCheckpointHeader(&expected, header.epoch, header.numRandomDraws);
+	if (memcmp(&header, &expected, sizeof(CheckpointHeader)) != 0) {
+		std::cout << fileName << " was written by a different version, network, device or training configuration\n";
+		exit(-1);
+	}
+	StreamCheckpoint(fp, true);
+	if (ferror(fp) || feof(fp)) {
+		std::cout << fileName << " is truncated\n";
+		exit(-1);
+	}
+	fclose(fp);
+	*numRandomDraws = header.numRandomDraws;
+	return header.epoch;
+}
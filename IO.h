@@ -39,8 +39,15 @@
 #ifndef IO_H_
 #define IO_H_
 
+#include <cstdio>
+#include <vector>
+
 void ReadTrainingDataFromFile(const char *trainPatchFileName, const char *trainLabelFileName);
 void ReadTestingDataFromFile(const char *testPatchFileName, const char *testLabelFileName);
 void PrintWeightToFile(const char *str);
+void ReadMeasuredDataFromFile(const char *fileName, std::vector<double> &dataConductanceLTP, std::vector<double> &dataConductanceLTD);
+void WriteCheckpoint(const char *fileName, int epoch, long long numRandomDraws);
+int ReadCheckpoint(const char *fileName, long long *numRandomDraws);
+void StreamCheckpoint(FILE *fp, bool load);	// Training state without the header, also the snapshot of the asynchronous validation
 
 #endif
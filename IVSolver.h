@@ -0,0 +1,73 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#ifndef IVSOLVER_H_
+#define IVSOLVER_H_
+
+#include <cmath>
+
+/* Read of a cell in series with its wire resistance: solve (readVoltage - v) / wireResistance = I(v) for the cell voltage v
+   with Newton steps kept inside the bisection bracket [0, readVoltage]. cellIV(v, &dIdv) returns the cell current at v and
+   its slope. An ohmic cell converges after one step, and a step that leaves the bracket falls back to bisection.
+   Returns the cell current */
+template <class CellIV>
+double SolveReadCurrent(double readVoltage, double wireResistance, CellIV &cellIV, int maxIter=30, double tolerance=1e-12) {
+	double dIdv;
+	if (wireResistance <= 0)	// No voltage drop on the wire
+		return cellIV(readVoltage, &dIdv);
+	double v1 = 0, v2 = readVoltage;
+	double v = readVoltage;
+	double cellCurrent = 0;
+	for (int iter=0; iter<maxIter; iter++) {
+		cellCurrent = cellIV(v, &dIdv);
+		double residual = (readVoltage - v) / wireResistance - cellCurrent;	// Decreasing in v
+		if (residual > 0)
+			v1 = v;
+		else
+			v2 = v;
+		double step = residual / (1 / wireResistance + dIdv);
+		if (fabs(step) <= tolerance * readVoltage)
+			break;
+		v += step;
+		if (!(v > v1 && v < v2))	// Outside the bracket (or NaN)
+			v = (v1 + v2) / 2;
+	}
+	return cellCurrent;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#ifndef INPUTPLANE_H_
+#define INPUTPLANE_H_
+
+#include <vector>
+#include "DataMatrix.h"
+
+/* Bit planes of the digitized inputs. For every image and every input bit n, the rows whose
+   nth bit is 1 are kept both as a packed bitset and as a list of row indices in ascending order,
+   so that the crossbar read loops only visit the rows that are actually driven. */
+class InputPlane {
+public:
+	int numImages, numRows, numBits;
+	int numWords;	// # of 64-bit words in one packed plane
+	std::vector<unsigned long long> bits;	// Packed planes, ordered as [image][bit][word]
+	std::vector<int> offset;	// Start of the [image][bit] list in activeRows (numImages*numBits+1 entries)
+	std::vector<int> activeRows;	// Active row indices of all the planes
+
+	InputPlane() { numImages = numRows = numBits = numWords = 0; }
+	void Build(DataMatrix<int> &digits, int numBits);
+
+	const unsigned long long *Plane(int image, int bit) const { return &bits[((size_t)image * numBits + bit) * numWords]; }
+	const int *ActiveRows(int image, int bit) const { return &activeRows[0] + offset[image * numBits + bit]; }
+	int NumActiveRows(int image, int bit) const { return offset[image * numBits + bit + 1] - offset[image * numBits + bit]; }
+	int NumActiveRows(int image) const { return offset[(image + 1) * numBits] - offset[image * numBits]; }	// Summed over all bits
+
+	/* Active rows of one bit of a vector that is produced on the fly (e.g. da1), returns the # of active rows */
+	static int FindActiveRows(const int *digits, int numRows, int bit, int *activeRows) {
+		int numActive = 0;
+		for (int k=0; k<numRows; k++) {
+			if ((digits[k]>>bit) & 1) {
+				activeRows[numActive++] = k;
+			}
+		}
+		return numActive;
+	}
+
+	/* Packed bitset (numWords words) of a list of active rows */
+	static void PackActiveRows(const int *activeRows, int numActive, int numWords, unsigned long long *plane) {
+		for (int w=0; w<numWords; w++) {
+			plane[w] = 0;
+		}
+		for (int r=0; r<numActive; r++) {
+			plane[activeRows[r]/64] |= 1ULL << (activeRows[r]%64);
+		}
+	}
+};
+
+#endif
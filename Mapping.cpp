@@ -41,12 +41,13 @@
 #include <random>
 #include "Param.h"
 #include "Array.h"
+#include "DataMatrix.h"
 #include "NeuroSim.h"
 
 extern Param *param;
 
-extern std::vector< std::vector<double> > weight1;
-extern std::vector< std::vector<double> > weight2;
+extern DataMatrix<double> weight1;
+extern DataMatrix<double> weight2;
 
 extern Array *arrayIH;
 extern Array *arrayHO;
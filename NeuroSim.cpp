@@ -38,6 +38,8 @@
 
 #include <cmath>
 #include <iostream>
+#include <map>
+#include <vector>
 #include "NeuroSim.h"
 #include "NeuroSim/constant.h"
 #include "NeuroSim/formula.h"
@@ -74,7 +76,7 @@ void NeuroSimSubArrayInitialize(SubArray *& subArray, Array *array, InputParamet
 	
 	subArray->numWritePulse = 8;		// Dynamic parameter (to be determined)
     
-	if(DigitalNVM *temp = dynamic_cast<DigitalNVM*>(array->cell[0][0]))
+	if(array->IsDigitalNVM())
 		subArray->digitalModeNeuro = 1;	// Use digital RRAM for Neuromorphic mode
 	else
 		subArray->digitalModeNeuro = 0;
@@ -95,7 +97,7 @@ void NeuroSimSubArrayInitialize(SubArray *& subArray, Array *array, InputParamet
 	cell.heightInFeatureSize = (array->cell[0][0])->heightInFeatureSize;	// Cell height in feature size
 	cell.widthInFeatureSize = (array->cell[0][0])->widthInFeatureSize;		// Cell width in feature size
    
-	if(SRAM *temp = dynamic_cast<SRAM*>(array->cell[0][0])){	// SRAM
+	if(array->IsSRAM()){	// SRAM
 		/* Transfer the cell properties from MLP simulator to NeuroSim */
 		cell.memCellType = Type::SRAM;
 		cell.widthSRAMCellNMOS = static_cast<SRAM*>(array->cell[0][0])->widthSRAMCellNMOS;
@@ -109,7 +111,7 @@ void NeuroSimSubArrayInitialize(SubArray *& subArray, Array *array, InputParamet
 	    else 
 			subArray->parallelRead=false;
 	} 
-    else if(HybridCell *temp = dynamic_cast<HybridCell*>(array->cell[0][0])){
+    else if(array->IsHybridCell()){
         cell.memCellType = Type::Hybrid;
 		subArray->readCircuitMode  = CMOS;	
 		subArray->maxNumIntBit = param->numBitPartialSum;	// Max # bits for the integrate-and-fire neuron
@@ -138,7 +140,7 @@ void NeuroSimSubArrayInitialize(SubArray *& subArray, Array *array, InputParamet
         cell.nonlinearity = (cell.nonlinearIV)? 10 : 2;	// This is the nonlinearity for the current ratio at Vw and Vw/2
         cell.accessVoltage = 1.1;	// Gate voltage
 	} 
-    else if(_2T1F *temp = dynamic_cast<_2T1F*>(array->cell[0][0])){ // 2T1F cell
+    else if(array->Is2T1F()){ // 2T1F cell
         cell.memCellType = Type::_2T1F;
         subArray->readCircuitMode  = CMOS;	// CMOS implementation for integrate-and-fire neuron
         subArray->maxNumIntBit = param->numBitPartialSum;	// Max # bits for the integrate-and-fire neuron
@@ -1172,6 +1174,57 @@ double NeuroSimNeuronReadEnergy(SubArray *subArray, Adder& adder, Mux& mux, RowD
 		return adder.readDynamicEnergy + mux.readDynamicEnergy + muxDecoder.readDynamicEnergy + dff.readDynamicEnergy + subtractor.readDynamicEnergy;
 }
 
+/* Cached read performance of each subArray, indexed by the number of active rows */
+struct NeuroSimReadCache {
+	std::vector<bool> valid;
+	std::vector<double> readDynamicEnergy;
+	std::vector<double> readLatency;
+};
+static std::map<SubArray*, NeuroSimReadCache> readCache;
+
+void NeuroSimReadPerformance(SubArray *subArray, int numActiveRows, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor, double *readDynamicEnergy, double *readLatency){	// For 1 weighted sum task on selected columns
+	NeuroSimReadCache& cache = readCache[subArray];
+	if ((size_t)numActiveRows >= cache.valid.size()) {
+		cache.valid.resize(numActiveRows+1, false);
+		cache.readDynamicEnergy.resize(numActiveRows+1);
+		cache.readLatency.resize(numActiveRows+1);
+	}
+	if (!cache.valid[numActiveRows]) {
+		cache.readDynamicEnergy[numActiveRows] = NeuroSimSubArrayReadEnergy(subArray) + NeuroSimNeuronReadEnergy(subArray, adder, mux, muxDecoder, dff, subtractor);
+		cache.readLatency[numActiveRows] = NeuroSimSubArrayReadLatency(subArray) + NeuroSimNeuronReadLatency(subArray, adder, mux, muxDecoder, dff, subtractor);
+		cache.valid[numActiveRows] = true;
+	}
+	*readDynamicEnergy = cache.readDynamicEnergy[numActiveRows];
+	*readLatency = cache.readLatency[numActiveRows];
+}
+
+void NeuroSimDeferRead(NeuroSimActivity& activity, int numActiveRows, int numTask){
+	#pragma omp atomic
+	activity.readCount[numActiveRows] += numTask;
+}
+
+void NeuroSimDeferWrite(NeuroSimActivity& activity, int numWritePulse, int numWriteOperationPerRow, int numWriteCellPerOperation, int numRowUpdate){
+	activity.writeCount[std::make_tuple(numWritePulse, numWriteOperationPerRow, numWriteCellPerOperation)] += numRowUpdate;
+}
+
+void NeuroSimFlushActivity(SubArray *subArray, NeuroSimActivity& activity, int numRow, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor){
+	for (size_t numActiveRows=0; numActiveRows<activity.readCount.size(); numActiveRows++) {
+		if (activity.readCount[numActiveRows] == 0)
+			continue;
+		subArray->activityRowRead = (double)numActiveRows/numRow/param->numBitInput;
+		double readDynamicEnergy, readLatency;
+		NeuroSimReadPerformance(subArray, numActiveRows, adder, mux, muxDecoder, dff, subtractor, &readDynamicEnergy, &readLatency);
+		subArray->readDynamicEnergy += activity.readCount[numActiveRows] * readDynamicEnergy;
+		subArray->readLatency += activity.readCount[numActiveRows] * readLatency;
+		activity.readCount[numActiveRows] = 0;
+	}
+	for (std::map<std::tuple<int, int, int>, double>::iterator it=activity.writeCount.begin(); it!=activity.writeCount.end(); it++) {
+		subArray->numWritePulse = std::get<0>(it->first);
+		subArray->writeDynamicEnergy += it->second * NeuroSimSubArrayWriteEnergy(subArray, std::get<1>(it->first), std::get<2>(it->first));
+	}
+	activity.writeCount.clear();
+}
+
 double NeuroSimNeuronLeakagePower(SubArray *subArray, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor){ // Same as NeuroSimNeuronReadEnergy
     adder.CalculatePower(1, adder.numAdder);
 	if (subArray->numColMuxed > 1){
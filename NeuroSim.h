@@ -49,6 +49,17 @@
 #include "NeuroSim/RowDecoder.h"
 #include "NeuroSim/DFF.h"
 #include "NeuroSim/Subtractor.h"
+#include <map>
+#include <tuple>
+#include <vector>
+
+/* Histograms of the NeuroSim inputs that change between images, for param->deferredNeuroSim */
+class NeuroSimActivity {
+public:
+	std::vector<double> readCount;	// Number of weighted sum tasks for each number of active rows
+	std::map<std::tuple<int, int, int>, double> writeCount;	// Number of row updates for each (numWritePulse, numWriteOperationPerRow, numWriteCellPerOperation)
+	NeuroSimActivity(int maxActiveRows): readCount(maxActiveRows+1, 0) {}
+};
 
 void NeuroSimSubArrayInitialize(SubArray *& subArray, Array *array, InputParameter& inputParameter, Technology& tech, MemCell& cell);
 void NeuroSimSubArrayArea(SubArray *subArray);
@@ -62,6 +73,11 @@ void NeuroSimNeuronInitialize(SubArray *& subArray, InputParameter& inputParamet
 void NeuroSimNeuronArea(SubArray *subArray, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor, double *height, double *width);
 double NeuroSimNeuronReadLatency(SubArray *subArray, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor);	// For 1 weighted sum task on selected columns
 double NeuroSimNeuronReadEnergy(SubArray *subArray, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor);	// For 1 weighted sum task on selected columns
+/* Sum of the 4 read functions above, evaluated once per distinct numActiveRows (subArray->activityRowRead must correspond to numActiveRows) */
+void NeuroSimReadPerformance(SubArray *subArray, int numActiveRows, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor, double *readDynamicEnergy, double *readLatency);
+void NeuroSimDeferRead(NeuroSimActivity& activity, int numActiveRows, int numTask);	// Thread-safe
+void NeuroSimDeferWrite(NeuroSimActivity& activity, int numWritePulse, int numWriteOperationPerRow, int numWriteCellPerOperation, int numRowUpdate);
+void NeuroSimFlushActivity(SubArray *subArray, NeuroSimActivity& activity, int numRow, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor);	// Add the recorded activity to the subArray energy and latency
 double NeuroSimNeuronLeakagePower(SubArray *subArray, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor);
 double NeuroSimNeuronTransferEnergy(SubArray *subArray, Adder& adder, Mux& mux, RowDecoder& muxDecoder, DFF& dff, Subtractor& subtractor); // for the hybrid cell
 
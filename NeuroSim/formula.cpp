@@ -50,7 +50,7 @@ extern Param* param;
 using namespace std;
 
 /* Beyond 22 nm technology, the value capIdealGate is the sum of capIdealGate and capOverlap and capFringe */
-double CalculateGateCap(double width, Technology tech) {
+double CalculateGateCap(double width, const Technology& tech) {
 	return (tech.capIdealGate + tech.capOverlap + tech.capFringe) * width   // 3 * tech.capFringe
 			+ tech.phyGateLength * tech.capPolywire;
 }
@@ -58,7 +58,7 @@ double CalculateGateCap(double width, Technology tech) {
 double CalculateGateArea(	// Calculate layout area and width of logic gate given fixed layout height
 		int gateType, int numInput,
 		double widthNMOS, double widthPMOS,
-		double heightTransistorRegion, Technology tech,
+		double heightTransistorRegion, const Technology& tech,
 		double *height, double *width) {
 	double	ratio = widthPMOS / (widthPMOS + widthNMOS);
 
@@ -191,7 +191,7 @@ double CalculateGateArea(	// Calculate layout area and width of logic gate given
 void CalculateGateCapacitance(
 		int gateType, int numInput,
 		double widthNMOS, double widthPMOS,
-		double heightTransistorRegion, Technology tech,
+		double heightTransistorRegion, const Technology& tech,
 		double *capInput, double *capOutput) {
 
 	double	ratio = widthPMOS / (widthPMOS + widthNMOS);
@@ -386,7 +386,7 @@ void CalculateGateCapacitance(
 
 double CalculateDrainCap(
 		double width, int type,
-		double heightTransistorRegion, Technology tech) {
+		double heightTransistorRegion, const Technology& tech) {
 	double drainCap = 0;
 	if (type == NMOS)
 		CalculateGateCapacitance(INV, 1, width, 0, heightTransistorRegion, tech, NULL, &drainCap);
@@ -398,14 +398,14 @@ double CalculateDrainCap(
 double CalculateGateLeakage(
 		int gateType, int numInput,
 		double widthNMOS, double widthPMOS,
-		double temperature, Technology tech) {
+		double temperature, const Technology& tech) {
 	int tempIndex = (int)temperature - 300;
 	if ((tempIndex > 100) || (tempIndex < 0)) {
 		cout<<"Error: Temperature is out of range"<<endl;
 		exit(-1);
 	}
-	double *leakN = tech.currentOffNmos;
-	double *leakP = tech.currentOffPmos;
+	const double *leakN = tech.currentOffNmos;
+	const double *leakP = tech.currentOffPmos;
 	double leakageN, leakageP;
 	switch (gateType) {
 	case INV:
@@ -433,7 +433,7 @@ double CalculateGateLeakage(
 	}
 }
 
-double CalculateOnResistance(double width, int type, double temperature, Technology tech) {
+double CalculateOnResistance(double width, int type, double temperature, const Technology& tech) {
 	double r;
 	int tempIndex = (int)temperature - 300;
 	if ((tempIndex > 100) || (tempIndex < 0)) {
@@ -447,7 +447,7 @@ double CalculateOnResistance(double width, int type, double temperature, Technol
 	return r;
 }
 
-double CalculateTransconductance(double width, int type, Technology tech) {
+double CalculateTransconductance(double width, int type, const Technology& tech) {
 	double gm;
 	if (type == NMOS) {
 		gm = (2*tech.current_gmNmos)*width/(0.7*tech.vdd-tech.vth);
@@ -470,7 +470,7 @@ double horowitz(double tr, double beta, double rampInput, double *rampOutput) {
 
 double CalculatePassGateArea(	// Calculate layout area, height and width of pass gate given the number of folding on the pass gate width
 								// This function is for pass gate where the cell height can change. For normal standard cells, use CalculateGateArea() where the cell height is fixed
-		double widthNMOS, double widthPMOS, Technology tech, int numFold, double *height, double *width) {
+		double widthNMOS, double widthPMOS, const Technology& tech, int numFold, double *height, double *width) {
 	
 	*width = (numFold + 1) * (POLY_WIDTH + MIN_GAP_BET_GATE_POLY) * tech.featureSize;	// No folding means numFold=1
 
@@ -36,20 +36,40 @@
 *   Xiaochen Peng   Email: xpeng15 at asu dot edu
 ********************************************************************************/
 
+#include <cstdio>
+#include <cstdlib>
 #include <string>
 #include "math.h"
 #include "Param.h"
 
 Param::Param() {
+	/* Simulation */
+	numThreads = 16;	// # of OpenMP threads
+	seed = 0;	// Seed of the random streams (see RNG.h) and of the order of the training images
+	outputFile = "output.csv";	// Accuracy of every validation (csv)
+	sweepFile = "";	// Design points to run concurrently on the loaded dataset, one point per line, see Sweep.h ("": one run with the current parameters)
+	sweepJobs = 4;	// # of design points run at the same time, each with numThreads/sweepJobs threads
+
 	/* MNIST dataset */
 	numMnistTrainImages = 60000;// # of training images in MNIST
 	numMnistTestImages = 10000;	// # of testing images in MNIST
+	useDataCache = true;	// Load the dataset from a binary cache (<patch file>.cache) if it is valid, and create it otherwise
+	mapDataCache = true;	// Map the dataset cache into memory instead of reading it (concurrent runs then share one page-cache copy)
 	
 	/* Algorithm parameters */
 	numTrainImagesPerEpoch = 8000;	// # of training images per epoch 
     numTrainImagesPerBatch = 1;   // # of training images per batch. It is 1 for SGD
 	totalNumEpochs = 125;	// Total number of epochs
 	interNumEpochs = 1;		// Internal number of epochs (print out the results every interNumEpochs)
+	sampledValidation = false;	// Validate on a growing stratified random subset of the test images until the accuracy is known to within validationTolerance
+	validationTolerance = 0.01;	// Half width of the accuracy confidence interval (fraction) at which sampled validation stops
+	validationZ = 1.96;	// z value of the confidence interval (1.96: 95%)
+	validationChunk = 500;	// # of test images added per round of sampled validation
+	fullValidationInterval = 10;	// Validate on all the test images every fullValidationInterval validations and at the end (0: only at the end)
+	asyncValidation = false;	// Validate each epoch in a worker process, on a snapshot of the training state, while the next epoch trains
+	checkpointInterval = 0;	// Write a binary checkpoint to checkpointFile every checkpointInterval validations (0: never)
+	checkpointFile = "checkpoint.bin";	// Checkpoint file written during training, see WriteCheckpoint in IO.cpp
+	resumeFile = "";	// Checkpoint to resume the training from, written with the same network and devices ("": start from the initial weights)
 	nInput = 400;     // # of neurons in input layer
 	nHide = 100;      // # of neurons in hidden layer
 	nOutput = 10;     // # of neurons in output layer
@@ -67,6 +87,8 @@ Param::Param() {
 	useHardwareInTrainingWU = true;   // Use hardware in the weight update part of training or not (true: realistic hardware, false: ideal software)
 	useHardwareInTraining = useHardwareInTrainingFF || useHardwareInTrainingWU;    // Use hardware in the training or not
 	useHardwareInTestingFF = true;    // Use hardware in the feed forward part of testing or not (true: realistic hardware, false: ideal software)
+	deviceIH = "RealDevice";	// Cell type of the synaptic array from input to hidden layer: "IdealDevice", "RealDevice", "MeasuredDevice", "SRAM", "DigitalNVM", "HybridCell" (3T1C+2PCM) or "_2T1F"
+	deviceHO = "RealDevice";	// Cell type of the synaptic array from hidden to output layer
 	numBitInput = 1;       // # of bits of the input data (=1 for black and white data)
 	numBitPartialSum = 8;  // # of bits of the digital output (partial weighted sum output)
 	pSumMaxHardware = pow(2, numBitPartialSum) - 1;   // Max digital output value of partial weighted sum
@@ -77,7 +99,10 @@ Param::Param() {
 	numColMuxed = 16;	// How many columns share 1 read circuit (for analog RRAM) or 1 S/A (for digital RRAM)
 	numWriteColMuxed = 16;	// How many columns share 1 write column decoder driver (for digital RRAM)
 	writeEnergyReport = true;	// Report write energy calculation or not
+	compactArray = false;	// Analog eNVM only: keep the cell state in contiguous per-field arrays with one shared device object per array instead of one object per cell
+	measuredDataFile = "";	// File with the measured LTP/LTD conductance curves of MeasuredDevice, see ReadMeasuredDataFromFile in IO.cpp ("": use the data in the MeasuredDevice constructor)
 	NeuroSimDynamicPerformance = true; // Report the dynamic performance (latency and energy) in NeuroSim or not
+	deferredNeuroSim = false;	// Only record the row activity in Train/Validate and evaluate NeuroSim once per distinct activity before each report (NeuroSimFlushActivity)
 	relaxArrayCellHeight = 0;	// True: relax the array cell height to standard logic cell height in the synaptic array
 	relaxArrayCellWidth = 0;	// True: relax the array cell width to standard logic cell width in the synaptic array
 	arrayWireWidth = 100;	// Array wire width (nm)
@@ -86,3 +111,23 @@ Param::Param() {
  
 }
 
+void Param::Update() {
+	useHardwareInTraining = useHardwareInTrainingFF || useHardwareInTrainingWU;
+	pSumMaxHardware = pow(2, numBitPartialSum) - 1;
+	numInputLevel = pow(2, numBitInput);
+	if (validationChunk < 1 || validationTolerance <= 0 || validationZ <= 0) {
+		puts("[Error] validationChunk must be at least 1, and validationTolerance and validationZ must be positive");
+		exit(-1);
+	}
+	if (interNumEpochs < 1 || numColMuxed < 1) {
+		puts("[Error] interNumEpochs and numColMuxed must be at least 1");
+		exit(-1);
+	}
+}
+
+double Param::DeviceParam(const char *cellType, const char *name, double value) {
+	if (deviceParams.empty())
+		return value;
+	std::map<std::string, double>::iterator it = deviceParams.find(std::string(cellType) + "." + name);
+	return it == deviceParams.end()? value : it->second;
+}
@@ -37,6 +37,7 @@
 ********************************************************************************/
 
 #include <string>
+#include <map>
 
 #ifndef PARAM_H_
 #define PARAM_H_
@@ -44,16 +45,36 @@
 class Param {
 public:
 	Param();
+	void Update();	// Recompute the derived parameters after the configuration changed the others (see Config.cpp)
+	double DeviceParam(const char *cellType, const char *name, double value);	// value, unless the configuration overrides <cellType>.<name>
+
+	/* Simulation */
+	int numThreads;	// # of OpenMP threads
+	unsigned int seed;	// Seed of the random streams (see RNG.h) and of the order of the training images
+	char* outputFile;	// Accuracy of every validation (csv)
+	char* sweepFile;	// Design points to run concurrently on the loaded dataset, see Sweep.h ("": one run with the current parameters)
+	int sweepJobs;	// # of design points run at the same time, each with numThreads/sweepJobs threads
 
 	/* MNIST dataset */
 	int numMnistTrainImages;// # of training images in MNIST
 	int numMnistTestImages;	// # of testing images in MNIST
+	bool useDataCache;	// Load the dataset from a binary cache (<patch file>.cache) if it is valid, and create it otherwise
+	bool mapDataCache;	// Map the dataset cache into memory instead of reading it (concurrent runs then share one page-cache copy)
 	
 	/* Algorithm parameters */
 	int numTrainImagesPerEpoch;	// # of training images per epoch
     int numTrainImagesPerBatch;
 	int totalNumEpochs;	// Total number of epochs
 	int interNumEpochs;	// Internal number of epochs (print out the results every interNumEpochs)
+	bool sampledValidation;	// Validate on a growing stratified random subset of the test images until the accuracy is known to within validationTolerance
+	double validationTolerance;	// Half width of the accuracy confidence interval (fraction) at which sampled validation stops
+	double validationZ;	// z value of the confidence interval (1.96: 95%)
+	int validationChunk;	// # of test images added per round of sampled validation
+	int fullValidationInterval;	// Validate on all the test images every fullValidationInterval validations and at the end (0: only at the end)
+	bool asyncValidation;	// Validate each epoch in a worker process, on a snapshot of the training state, while the next epoch trains
+	int checkpointInterval;	// Write a binary checkpoint to checkpointFile every checkpointInterval validations (0: never)
+	char* checkpointFile;	// Checkpoint file written during training
+	char* resumeFile;	// Checkpoint to resume the training from ("": start from the initial weights)
 	int nInput;     // # of neurons in input layer
 	int nHide;      // # of neurons in hidden layer
 	int nOutput;	// # of neurons in output layer
@@ -68,6 +89,9 @@ public:
 	bool useHardwareInTrainingWU;   // Use hardware in the weight update part of training or not (true: realistic hardware, false: ideal software)
 	bool useHardwareInTraining;		// Use hardware in the training or not
 	bool useHardwareInTestingFF;    // Use hardware in the feed forward part of testing or not (true: realistic hardware, false: ideal software)
+	char* deviceIH;	// Cell type of the synaptic array from input to hidden layer
+	char* deviceHO;	// Cell type of the synaptic array from hidden to output layer
+	std::map<std::string, double> deviceParams;	// Device parameter overrides from the configuration, keyed by "<cell type>.<name>"
 	int numBitInput;		// # of bits of the input data (=1 for black and white data)
 	int numBitPartialSum;	// # of bits of the digital output (partial weighted sum output)
 	int pSumMaxHardware;	// Max digital output value of partial weighted sum
@@ -78,7 +102,10 @@ public:
 	int numColMuxed;	// How many columns share 1 read circuit (for analog RRAM) or 1 S/A (for digital RRAM)
 	int numWriteColMuxed;	// How many columns share 1 write column decoder driver (for digital RRAM)
 	bool writeEnergyReport;	// Report write energy calculation or not
+	bool compactArray;	// Analog eNVM only: keep the cell state in contiguous per-field arrays with one shared device object per array
+	char* measuredDataFile;	// File with the measured LTP/LTD conductance curves of MeasuredDevice ("": use the data in the MeasuredDevice constructor)
 	bool NeuroSimDynamicPerformance; // Report the dynamic performance (latency and energy) in NeuroSim or not
+	bool deferredNeuroSim;	// Only record the row activity in Train/Validate and evaluate NeuroSim once per distinct activity before each report
 	bool relaxArrayCellHeight;	// True: relax the array cell height to standard logic cell height in the synaptic array
 	bool relaxArrayCellWidth;	// True: relax the array cell width to standard logic cell width in the synaptic array
 	double arrayWireWidth;	// Array wire width (nm)
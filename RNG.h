@@ -0,0 +1,78 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#ifndef RNG_H_
+#define RNG_H_
+
+/* Counter-based random streams (Philox4x32-10). Every draw is a pure function of the context below and of the
+   drawing cell (x, y, stream, draw), so the results do not depend on the number of threads or on the order of the draws */
+struct RandomContext {
+	unsigned int seed;	// Simulation seed
+	int epoch;	// Set by main for each Train/Validate call
+	int image;	// Training sample within the epoch, or test image
+	int phase;	// Which pass over the arrays is running (RandomPhase, plus the input bit for the read passes)
+};
+extern RandomContext randomContext;
+#pragma omp threadprivate(randomContext)	// Pass it into parallel regions with copyin(randomContext)
+
+enum RandomPhase {
+	RANDOM_PHASE_TRAIN_IH = 0,	// + input bit
+	RANDOM_PHASE_TRAIN_HO = 64,	// + input bit
+	RANDOM_PHASE_UPDATE_IH = 128,
+	RANDOM_PHASE_UPDATE_HO = 129,
+	RANDOM_PHASE_TRANSFER = 130,
+	RANDOM_PHASE_SETUP_IH = 131,	// Device-to-device variation drawn when the arrays are built
+	RANDOM_PHASE_SETUP_HO = 132,
+	RANDOM_PHASE_SAMPLE = 133,	// Order of the test images in sampled validation
+	RANDOM_PHASE_TEST_IH = 256,	// + input bit
+	RANDOM_PHASE_TEST_HO = 320	// + input bit
+};
+
+enum RandomDraw {
+	RANDOM_READ_NOISE,
+	RANDOM_WRITE_NOISE,
+	RANDOM_D2D_NL_LTP,
+	RANDOM_D2D_NL_LTD,
+	RANDOM_D2D_MAX_CONDUCTANCE,
+	RANDOM_D2D_MIN_CONDUCTANCE
+};
+
+void Philox4x32(const unsigned int counter[4], const unsigned int key[2], unsigned int out[4]);
+double RandomNormal(int x, int y, int stream, int draw);	// Standard normal number for cell (x,y) in the current context
+
+#endif
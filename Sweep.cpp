@@ -0,0 +1,209 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Param.h"
+#include "Config.h"
+#include "Sweep.h"
+
+extern Param *param;
+
+typedef std::vector<std::pair<std::string, std::string> > SweepPoint;
+typedef std::vector<std::pair<std::string, std::vector<std::string> > > SweepLine;
+
+/* One point per combination of the value lists of the line */
+static void ExpandSweepLine(const SweepLine &line, size_t i, SweepPoint &point, std::vector<SweepPoint> &points) {
+	if (i == line.size()) {
+		points.push_back(point);
+		return;
+	}
+	for (size_t v=0; v<line[i].second.size(); v++) {
+		point.push_back(std::make_pair(line[i].first, line[i].second[v]));
+		ExpandSweepLine(line, i+1, point, points);
+		point.pop_back();
+	}
+}
+
+static std::vector<SweepPoint> ReadSweepFile(const char *fileName) {
+	FILE *fp = fopen(fileName, "r");
+	if (!fp) {
+		printf("%s cannot be found!\n", fileName);
+		exit(-1);
+	}
+	std::vector<SweepPoint> points;
+	char text[4096];
+	for (int numLine=1; fgets(text, sizeof(text), fp); numLine++) {
+		char *comment = strchr(text, '#');
+		if (comment)
+			*comment = '\0';
+		SweepLine line;
+		for (char *token = strtok(text, " \t\r\n"); token; token = strtok(NULL, " \t\r\n")) {
+			char *separator = strchr(token, '=');
+			if (!separator || separator == token) {
+				printf("[Error] \"%s\" in line %d of %s is not key=value\n", token, numLine, fileName);
+				exit(-1);
+			}
+			line.push_back(std::make_pair(std::string(token, separator - token), std::vector<std::string>()));
+			std::string values(separator + 1);
+			for (size_t start = 0, end; start <= values.size(); start = end + 1) {
+				end = values.find(',', start);
+				if (end == std::string::npos)
+					end = values.size();
+				line.back().second.push_back(values.substr(start, end - start));
+			}
+		}
+		if (!line.empty()) {
+			SweepPoint point;
+			ExpandSweepLine(line, 0, point, points);
+		}
+	}
+	fclose(fp);
+	return points;
+}
+
+static void ApplySweepPoint(const SweepPoint &point) {
+	for (size_t i=0; i<point.size(); i++)
+		SetParameter(point[i].first.c_str(), point[i].second.c_str());
+	param->Update();
+}
+
+static std::string SweepPointText(const SweepPoint &point) {
+	std::string text;
+	for (size_t i=0; i<point.size(); i++)
+		text += (i? " " : "") + point[i].first + "=" + point[i].second;
+	return text;
+}
+
+/* The dataset is loaded once before the points start, so a point cannot change what it was loaded with */
+static void CheckSweepPoint(const SweepPoint &point, int n) {
+	Param saved = *param;
+	ApplySweepPoint(point);
+	bool valid = param->numMnistTrainImages == saved.numMnistTrainImages && param->numMnistTestImages == saved.numMnistTestImages
+			&& param->nInput == saved.nInput && param->nOutput == saved.nOutput && param->numBitInput == saved.numBitInput
+			&& param->BWthreshold == saved.BWthreshold;
+	*param = saved;
+	if (!valid) {
+		printf("[Error] Point %d (%s) changes the dataset, which is shared by all the points\n", n, SweepPointText(point).c_str());
+		exit(-1);
+	}
+}
+
+int RunSweep(const char *fileName, int (*simulate)()) {
+	std::vector<SweepPoint> points = ReadSweepFile(fileName);
+	int numPoints = points.size();
+	for (int n=0; n<numPoints; n++)
+		CheckSweepPoint(points[n], n);
+	int numJobs = std::max(1, std::min(param->sweepJobs, numPoints));
+	int numThreadsPerPoint = std::max(1, param->numThreads / numJobs);
+	printf("Sweep of %d design points, %d at a time with %d threads each\n", numPoints, numJobs, numThreadsPerPoint);
+
+	/* A new point starts as soon as a running one finishes */
+	std::vector<pid_t> pid(numPoints, 0);
+	std::vector<int> status(numPoints, -1);
+	int next = 0, numRunning = 0;
+	while (next < numPoints || numRunning > 0) {
+		while (numRunning < numJobs && next < numPoints) {
+			fflush(stdout);
+			pid[next] = fork();
+			if (pid[next] < 0) {
+				puts("Cannot start the design point");
+				exit(-1);
+			}
+			if (pid[next] == 0) {
+				char name[64];
+				ApplySweepPoint(points[next]);
+				param->numThreads = numThreadsPerPoint;
+				sprintf(name, "sweep_%d.csv", next);
+				param->outputFile = strdup(name);
+				sprintf(name, "sweep_%d.ckpt", next);
+				param->checkpointFile = strdup(name);
+				sprintf(name, "sweep_%d.log", next);
+				if (!freopen(name, "w", stdout)) {
+					printf("%s cannot be written\n", name);
+					exit(-1);
+				}
+				printf("Design point %d: %s\n", next, SweepPointText(points[next]).c_str());
+				exit(simulate());
+			}
+			printf("Point %d started: %s\n", next, SweepPointText(points[next]).c_str());
+			next++;
+			numRunning++;
+		}
+		int childStatus;
+		pid_t done = wait(&childStatus);
+		if (done < 0)
+			break;
+		for (int n=0; n<numPoints; n++) {
+			if (pid[n] == done) {
+				status[n] = WIFEXITED(childStatus)? WEXITSTATUS(childStatus) : -1;
+				numRunning--;
+				printf("Point %d finished%s\n", n, status[n] == 0? "" : " with an error");
+			}
+		}
+	}
+
+	/* Summary: the last accuracy of every point */
+	int numFailed = 0;
+	printf("\n");
+	for (int n=0; n<numPoints; n++) {
+		char name[64], line[256];
+		int epoch = 0;
+		double accuracy = 0;
+		sprintf(name, "sweep_%d.csv", n);
+		FILE *fp = fopen(name, "r");
+		while (fp && fgets(line, sizeof(line), fp))
+			sscanf(line, "%d, %lf", &epoch, &accuracy);
+		if (fp)
+			fclose(fp);
+		if (status[n] == 0 && epoch > 0) {
+			printf("Point %d (%s): accuracy at %d epochs is %.2f%%\n", n, SweepPointText(points[n]).c_str(), epoch, accuracy);
+		} else {
+			printf("Point %d (%s): failed, see sweep_%d.log\n", n, SweepPointText(points[n]).c_str(), n);
+			numFailed++;
+		}
+	}
+	return numFailed? -1 : 0;
+}
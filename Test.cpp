@@ -37,24 +37,31 @@
 ********************************************************************************/
 
 #include <cstdio>
+#include <cmath>
 #include <iostream>
+#include <algorithm>
 #include <vector>
 #include <random>
 #include "formula.h"
 #include "Param.h"
 #include "Array.h"
+#include "DataMatrix.h"
+#include "Gemm.h"
+#include "InputPlane.h"
 #include "Mapping.h"
 #include "NeuroSim.h"
 #include "Cell.h"
+#include "RNG.h"
 
 extern Param *param;
 
-extern std::vector< std::vector<double> > testInput;
-extern std::vector< std::vector<int> > dTestInput;
-extern std::vector< std::vector<double> > testOutput;
+extern DataMatrix<double> testInput;
+extern DataMatrix<int> dTestInput;
+extern DataMatrix<double> testOutput;
+extern InputPlane testInputPlane;
 
-extern std::vector< std::vector<double> > weight1;
-extern std::vector< std::vector<double> > weight2;
+extern DataMatrix<double> weight1;
+extern DataMatrix<double> weight2;
 
 extern Technology techIH;
 extern Technology techHO;
@@ -72,11 +79,48 @@ extern Mux muxHO;
 extern RowDecoder muxDecoderHO;
 extern DFF dffHO;
 extern Subtractor subtractorHO;
+extern NeuroSimActivity activityIH;
+extern NeuroSimActivity activityHO;
 
 extern int correct;		// # of correct prediction
+extern int numValidated;
+extern double validationHalfWidth;
 
-/* Validation */
-void Validate() {
+/* Order of the test images for sampled validation: every class is shuffled and the classes are interleaved
+   so that any prefix of the order holds each class in proportion to its share of the test set */
+void StratifiedTestOrder(std::vector<int> &order) {
+	int numImages = param->numMnistTestImages;
+	std::vector<int> label(numImages), classSize(param->nOutput, 0);
+	std::vector< std::pair<unsigned int, int> > keyed(numImages);
+	for (int i=0; i<numImages; i++) {
+		label[i] = 0;
+		for (int j=0; j<param->nOutput; j++) {
+			if (testOutput[i][j] == 1)
+				label[i] = j;
+		}
+		classSize[label[i]]++;
+		unsigned int counter[4] = {(unsigned int)i, (unsigned int)RANDOM_PHASE_SAMPLE << 16, 0, 0};
+		unsigned int key[2] = {randomContext.seed, (unsigned int)randomContext.epoch};
+		unsigned int r[4];
+		Philox4x32(counter, key, r);
+		keyed[i] = std::make_pair(r[0], i);
+	}
+	std::sort(keyed.begin(), keyed.end());	// Random order, then the rank of each image within its class
+	std::vector<int> classRank(param->nOutput, 0);
+	std::vector< std::pair<double, int> > position(numImages);
+	for (int n=0; n<numImages; n++) {
+		int i = keyed[n].second;
+		position[n] = std::make_pair((classRank[label[i]]++ + 0.5) / classSize[label[i]], i);
+	}
+	std::sort(position.begin(), position.end());
+	order.resize(numImages);
+	for (int n=0; n<numImages; n++)
+		order[n] = position[n].second;
+}
+
+/* Validation. With sampled=true the test images are evaluated in chunks of validationChunk in stratified random order,
+   and the evaluation stops once the accuracy confidence interval is narrower than validationTolerance */
+void Validate(bool sampled) {
 	int numBatchReadSynapse;    // # of read synapses in a batch read operation (decide later)
 	double outN1[param->nHide]; // Net input to the hidden layer [param->nHide]
 	double a1[param->nHide];    // Net output of hidden layer [param->nHide] also the input of hidden layer to output layer
@@ -95,14 +139,14 @@ void Validate() {
 	double sumArrayReadEnergyHO = 0;    // Use a temporary variable here since OpenMP does not support reduction on class member
 	double sumNeuroSimReadEnergyHO = 0; // Use a temporary variable here since OpenMP does not support reduction on class member
 	double sumReadLatencyHO = 0;    // Use a temporary variable here since OpenMP does not support reduction on class member
-    if(eNVM* temp = dynamic_cast<eNVM*>(arrayIH->cell[0][0]))
+    if(arrayIH->IseNVM())
     {
         readVoltageIH = static_cast<eNVM*>(arrayIH->cell[0][0])->readVoltage;
         readVoltageHO = static_cast<eNVM*>(arrayHO->cell[0][0])->readVoltage;
         readPulseWidthIH = static_cast<eNVM*>(arrayIH->cell[0][0])->readPulseWidth;
 	    readPulseWidthHO = static_cast<eNVM*>(arrayHO->cell[0][0])->readPulseWidth;
     }
-    else if(HybridCell* temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
+    else if(arrayIH->IsHybridCell())
     {         
          readVoltageIH = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.readVoltage;
         readVoltageHO = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.readVoltage;
@@ -112,374 +156,396 @@ void Validate() {
 	    readPulseWidthMSB = static_cast<HybridCell*>(arrayHO->cell[0][0])->MSBcell_LTP.readPulseWidth;       
 
     }
-    
-    #pragma omp parallel for private(outN1, a1, da1, outN2, a2, tempMax, countNum, numBatchReadSynapse) reduction(+: correct, sumArrayReadEnergyIH, sumNeuroSimReadEnergyIH, sumArrayReadEnergyHO, sumNeuroSimReadEnergyHO, sumReadLatencyIH, sumReadLatencyHO)
-	for (int i = 0; i < param->numMnistTestImages; i++)
-	{
-		// Forward propagation
-		/* First layer from input layer to the hidden layer */
-		std::fill_n(outN1, param->nHide, 0);
-		std::fill_n(a1, param->nHide, 0);
-		if (param->useHardwareInTestingFF) {    // Hardware
-			for (int j=0; j<param->nHide; j++) {
-				if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
-					if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
-						sumArrayReadEnergyIH += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput; // All WLs open
-					}
-				} else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0])) { // Digital eNVM
-					if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
-						sumArrayReadEnergyIH += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd;  // Selected WL
-					} else {    // Cross-point
-						sumArrayReadEnergyIH += arrayIH->wireCapRow * techIH.vdd * techIH.vdd * (param->nInput - 1);    // Unselected WLs
-					}
-				}else if (HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))  // 3T1C cell
-						sumArrayReadEnergyIH += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput; // All WLs open
-				
-                for (int n=0; n<param->numBitInput; n++) {
-					double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayIH->arrayRowSize;   // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
-					if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
-						double Isum = 0;    // weighted sum current
-						double IsumMax = 0; // Max weighted sum current
-						double IsumMin = 0; // Max weighted sum current
-						double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
-						for (int k=0; k<param->nInput; k++) {
-							if ((dTestInput[i][k]>>n) & 1) {    // if the nth bit of dTestInput[i][k] is 1
-								Isum += arrayIH->ReadCell(j,k);
-								inputSum += arrayIH->GetMediumCellReadCurrent(j,k);
+
+	int numImages = param->numMnistTestImages;
+	std::vector<int> order;
+	if (sampled)
+		StratifiedTestOrder(order);
+	int chunk = sampled? std::min(param->validationChunk, numImages) : numImages;
+
+	/* The algorithm path does the first layer of the images of a chunk as one matrix product,
+	   gathering the sampled rows first so that only the validated images are computed */
+	DataMatrix<double> testOutN1(param->useHardwareInTestingFF? 0 : chunk, param->nHide);
+	DataMatrix<double> chunkInput(param->useHardwareInTestingFF || !sampled? 0 : chunk, param->nInput);
+	validationHalfWidth = 0;
+	for (int start = 0; start < numImages; start += chunk) {
+		int end = std::min(start + chunk, numImages);
+		if (!param->useHardwareInTestingFF) {
+			if (sampled) {
+				for (int t = start; t < end; t++)
+					std::copy(testInput[order[t]], testInput[order[t]] + param->nInput, chunkInput[t - start]);
+				MatMulTransposed(chunkInput, 0, end - start, weight1, testOutN1);
+			} else {
+				MatMulTransposed(testInput, start, end - start, weight1, testOutN1);
+			}
+		}
+		#pragma omp parallel for private(outN1, a1, da1, outN2, a2, tempMax, countNum, numBatchReadSynapse) reduction(+: correct, sumArrayReadEnergyIH, sumNeuroSimReadEnergyIH, sumArrayReadEnergyHO, sumNeuroSimReadEnergyHO, sumReadLatencyIH, sumReadLatencyHO) copyin(randomContext)
+		for (int t = start; t < end; t++)
+		{
+			int i = sampled? order[t] : t;
+			randomContext.image = i;
+			// Forward propagation
+			/* First layer from input layer to the hidden layer */
+			std::fill_n(outN1, param->nHide, 0);
+			std::fill_n(a1, param->nHide, 0);
+			if (param->useHardwareInTestingFF) {    // Hardware
+				for (int j=0; j<param->nHide; j++) {
+					if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
+						if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
+							sumArrayReadEnergyIH += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput; // All WLs open
+						}
+					} else if (arrayIH->IsDigitalNVM()) { // Digital eNVM
+						if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
+							sumArrayReadEnergyIH += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd;  // Selected WL
+						} else {    // Cross-point
+							sumArrayReadEnergyIH += arrayIH->wireCapRow * techIH.vdd * techIH.vdd * (param->nInput - 1);    // Unselected WLs
+						}
+					}else if (arrayIH->IsHybridCell())  // 3T1C cell
+							sumArrayReadEnergyIH += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput; // All WLs open
+					
+	                for (int n=0; n<param->numBitInput; n++) {
+						double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayIH->arrayRowSize;   // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
+						const int *activeRows = testInputPlane.ActiveRows(i, n);
+						randomContext.phase = RANDOM_PHASE_TEST_IH + n;
+						int numActiveRows = testInputPlane.NumActiveRows(i, n);
+						if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
+							double Isum = 0;    // weighted sum current
+							double IsumMax = arrayIH->columnIsumMax[j]; // Max weighted sum current
+							double IsumMin = arrayIH->columnIsumMin[j]; // Max weighted sum current
+							double inputSum = arrayIH->ReferenceColumnCurrent(j, activeRows, numActiveRows);    // Weighted sum current of input vector * weight=1 column
+							Isum = arrayIH->ReadColumnCurrent(j, activeRows, numActiveRows);
+							for (int r=0; r<numActiveRows; r++) {    // rows whose nth bit of dTestInput[i][k] is 1
 								sumArrayReadEnergyIH += arrayIH->wireCapRow * readVoltageIH * readVoltageIH;   // Selected BLs (1T1R) or Selected WLs (cross-point)
 							}
-							IsumMax += arrayIH->GetMaxCellReadCurrent(j,k);
-							IsumMin += arrayIH->GetMinCellReadCurrent(j,k);
-						}
-						sumArrayReadEnergyIH += Isum * readVoltageIH * readPulseWidthIH;
-						int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(inputSum, IsumMax-IsumMin));
-                        //int outputDigits = (CurrentToDigits(Isum, IsumMax)-CurrentToDigits(inputSum, IsumMax));
-						outN1[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);
-					} 
-                    else if(HybridCell* temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
-                    {
-                        double Isum_LSB = 0;              // weighted sum current of the LTP cell
-                        double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
-                        double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
-                        double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
-                        double IsumMin_LSB = 0;
-                        double IsumMax_MSB = 0;
-                        double IsumMin_MSB = 0;                        
-                        double inputSum_LSB= 0;      // Reference for LSB cell
-                        for (int k=0; k<param->nInput; k++) {
-							if ((dTestInput[i][k]>>n) & 1) {    // if the nth bit of dTestInput[i][k] is 1
+							sumArrayReadEnergyIH += Isum * readVoltageIH * readPulseWidthIH;
+							int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(inputSum, IsumMax-IsumMin));
+	                        //int outputDigits = (CurrentToDigits(Isum, IsumMax)-CurrentToDigits(inputSum, IsumMax));
+							outN1[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);
+						} 
+	                    else if(arrayIH->IsHybridCell())
+	                    {
+	                        double Isum_LSB = 0;              // weighted sum current of the LTP cell
+	                        double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
+	                        double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
+	                        double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
+	                        double IsumMin_LSB = 0;
+	                        double IsumMax_MSB = 0;
+	                        double IsumMin_MSB = 0;                        
+	                        double inputSum_LSB= 0;      // Reference for LSB cell
+	                        for (int r=0; r<numActiveRows; r++) {    // rows whose nth bit of dTestInput[i][k] is 1
+								int k = activeRows[r];
 								Isum_LSB += arrayIH->ReadCell(j,k,"LSB");
-                                Isum_MSB_LTP += arrayIH->ReadCell(j,k,"MSB_LTP");  
-                                Isum_MSB_LTD += arrayIH->ReadCell(j,k,"MSB_LTD");  
+								Isum_MSB_LTP += arrayIH->ReadCell(j,k,"MSB_LTP");  
+								Isum_MSB_LTD += arrayIH->ReadCell(j,k,"MSB_LTD");  
 								inputSum_LSB += arrayIH->GetMediumCellReadCurrent(j,k);
-                                sumArrayReadEnergyIH += arrayIH->wireCapRow * readVoltageIH * readVoltageIH;   // Selected BLs (1T1R) or Selected WLs (cross-point)
-                                sumArrayReadEnergyIH += 2*arrayIH->wireCapRow * readVoltageMSB * readVoltageMSB; // Selected BLs (1T1R) or Selected WLs (cross-point)
+								sumArrayReadEnergyIH += arrayIH->wireCapRow * readVoltageIH * readVoltageIH;   // Selected BLs (1T1R) or Selected WLs (cross-point)
+								sumArrayReadEnergyIH += 2*arrayIH->wireCapRow * readVoltageMSB * readVoltageMSB; // Selected BLs (1T1R) or Selected WLs (cross-point)
 							}
-							IsumMax_LSB += arrayIH->GetMaxCellReadCurrent(j,k,"LSB");
-                         	IsumMin_LSB += arrayIH->GetMinCellReadCurrent(j,k,"LSB");
-                            IsumMax_MSB += arrayIH->GetMaxCellReadCurrent(j,k,"MSB");
-                            IsumMin_MSB += arrayIH->GetMinCellReadCurrent(j,k,"MSB");
-						}
-                        sumArrayReadEnergyIH += Isum_LSB * readVoltageIH * readPulseWidthIH;
-                        sumArrayReadEnergyIH += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
-                        int outputDigits;
-                        int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(inputSum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
-                        //int outputDigitsLSB = CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(inputSum_LSB, IsumMax_LSB-IsumMin_LSB); //minus the reference
-                        int outputDigitsMSB = CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB); //minus the reference
-                        outputDigits = static_cast<HybridCell*>(arrayIH->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
-                        outN1[j] += DigitsToAlgorithm(outputDigits/3, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1);;   
-                    }
-                    else {
-                            bool digitalNVM = false; 
-                            bool parallelRead = false;
-                            if(DigitalNVM*temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0]))
-                            {    digitalNVM = true;
-                                if(static_cast<DigitalNVM*>(arrayIH->cell[0][0])->parallelRead == true) 
-								{
-                                    parallelRead = true;
-                                }
-                            }
-                            if(digitalNVM && parallelRead) // parallel read-out for DigitalNVM
-                            {
-                                    double Imax = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
-                                    double Imin = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
-                                    double Isum = 0;    // weighted sum current
-							        double IsumMax = 0; // Max weighted sum current
-							        double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
-                                    int Dsum=0;
-                                    int DsumMax = 0;
-                                    int Dref = 0;
-                                    for (int w=0;w<param->numWeightBit;w++){
-                                        int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
-									    for (int k=0; k<param->nInput; k++) 
-                                        {
-										    if((dTestInput[i][k]>>n) & 1){ // accumulate the current along a column
+	                        for (int k=0; k<param->nInput; k++) {
+								IsumMax_LSB += arrayIH->GetMaxCellReadCurrent(j,k,"LSB");
+	                         	IsumMin_LSB += arrayIH->GetMinCellReadCurrent(j,k,"LSB");
+	                            IsumMax_MSB += arrayIH->GetMaxCellReadCurrent(j,k,"MSB");
+	                            IsumMin_MSB += arrayIH->GetMinCellReadCurrent(j,k,"MSB");
+							}
+	                        sumArrayReadEnergyIH += Isum_LSB * readVoltageIH * readPulseWidthIH;
+	                        sumArrayReadEnergyIH += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
+	                        int outputDigits;
+	                        int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(inputSum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
+	                        //int outputDigitsLSB = CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(inputSum_LSB, IsumMax_LSB-IsumMin_LSB); //minus the reference
+	                        int outputDigitsMSB = CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB); //minus the reference
+	                        outputDigits = static_cast<HybridCell*>(arrayIH->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
+	                        outN1[j] += DigitsToAlgorithm(outputDigits/3, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1);;   
+	                    }
+	                    else {
+	                            bool digitalNVM = false; 
+	                            bool parallelRead = false;
+	                            if(arrayIH->IsDigitalNVM())
+	                            {    digitalNVM = true;
+	                                if(static_cast<DigitalNVM*>(arrayIH->cell[0][0])->parallelRead == true) 
+									{
+	                                    parallelRead = true;
+	                                }
+	                            }
+	                            if(digitalNVM && parallelRead) // parallel read-out for DigitalNVM
+	                            {
+	                                    double Imax = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
+	                                    double Imin = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
+	                                    double Isum = 0;    // weighted sum current
+								        double IsumMax = 0; // Max weighted sum current
+								        double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
+	                                    int Dsum=0;
+	                                    int DsumMax = 0;
+	                                    int Dref = 0;
+	                                    for (int w=0;w<param->numWeightBit;w++){
+	                                        int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
+										    for (int r=0; r<numActiveRows; r++) // accumulate the current along a column
+	                                        {
+											    int k = activeRows[r];
 											    Isum += static_cast<DigitalNVM*>(arrayIH->cell[colIndex ][k])->conductance*static_cast<DigitalNVM*>(arrayIH->cell[colIndex ][k])->readVoltage;
 											    //inputSum += Imin;
-                                                inputSum += static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->readVoltage;
+	                                            inputSum += static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->readVoltage;
 										    }
-									    }
-                                       /* int outputDigits = (Isum - inputSum)/(Imax-Imin); // the output at the ADC of this column
-                                                                                                               // basically, this is the number of "1" in this column
-                                        if(outputDigits > param->pSumMaxHardware)
-                                            outputDigits = param->pSumMaxHardware; */
-                                        int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column
-                                                                                                               // basically, this is the number of "1" in this column
-                                        int outputDigitsRef = (int) (inputSum/(Imax-Imin));
-                                    
-                                        if(outputDigits > param->pSumMaxHardware)
-                                            outputDigits = param->pSumMaxHardware;
-                                        if(outputDigitsRef > param->pSumMaxHardware)
-                                            outputDigitsRef = param->pSumMaxHardware;
-                                        outputDigits = outputDigits-outputDigitsRef;
-                                            
-                                        Dref = (int)(inputSum/Imin);
-                                        Isum=0;
-                                        inputSum=0;
-                                        Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
-                                        DsumMax += param->nInput*(int) pow(2,w); // the maximum weight that can be represented by this column
-        
-                                    }
-                                    outN1[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
-                                    sumArrayReadEnergyIH  += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
-                            }
-                            else
-                            {	 // Digital NVM or SRAM row-by-row readout				
-							    int Dsum = 0;
-							    int DsumMax = 0;
-							    int inputSum = 0;
-							    for (int k=0; k<param->nInput; k++) {
-								    if ((dTestInput[i][k]>>n) & 1) {    // if the nth bit of dInput[i][k] is 1
-									    Dsum += (int)(arrayIH->ReadCell(j,k));
-									    inputSum += pow(2, arrayIH->numCellPerSynapse-1) - 1;   // get the digital weights of the dummy column as reference
+	                                       /* int outputDigits = (Isum - inputSum)/(Imax-Imin); // the output at the ADC of this column
+	                                                                                                               // basically, this is the number of "1" in this column
+	                                        if(outputDigits > param->pSumMaxHardware)
+	                                            outputDigits = param->pSumMaxHardware; */
+	                                        int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column
+	                                                                                                               // basically, this is the number of "1" in this column
+	                                        int outputDigitsRef = (int) (inputSum/(Imax-Imin));
+	                                    
+	                                        if(outputDigits > param->pSumMaxHardware)
+	                                            outputDigits = param->pSumMaxHardware;
+	                                        if(outputDigitsRef > param->pSumMaxHardware)
+	                                            outputDigitsRef = param->pSumMaxHardware;
+	                                        outputDigits = outputDigits-outputDigitsRef;
+	                                            
+	                                        Dref = (int)(inputSum/Imin);
+	                                        Isum=0;
+	                                        inputSum=0;
+	                                        Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
+	                                        DsumMax += param->nInput*(int) pow(2,w); // the maximum weight that can be represented by this column
+	        
+	                                    }
+	                                    outN1[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
+	                                    sumArrayReadEnergyIH  += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
+	                            }
+	                            else
+	                            {	 // Digital NVM or SRAM row-by-row readout				
+								    int Dsum = arrayIH->ReadColumnDigits(j, activeRows, numActiveRows, testInputPlane.Plane(i, n));    // rows whose nth bit of dTestInput[i][k] is 1
+								    int DsumMax = param->nInput * ((1 << arrayIH->numCellPerSynapse) - 1);
+								    int inputSum = numActiveRows * ((1 << (arrayIH->numCellPerSynapse-1)) - 1);   // get the digital weights of the dummy column as reference
+								    if (arrayIH->IsDigitalNVM()) {    // Digital eNVM
+									    sumArrayReadEnergyIH  += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
+								    } 
+	                                else {    // SRAM
+									    sumArrayReadEnergyIH  += static_cast<SRAM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
 								    }
-								    DsumMax += pow(2, arrayIH->numCellPerSynapse) - 1;
-							    }
-							    if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0])) {    // Digital eNVM
-								    sumArrayReadEnergyIH  += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
-							    } 
-                                else {    // SRAM
-								    sumArrayReadEnergyIH  += static_cast<SRAM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
-							    }
-							    outN1[j] += (double)(Dsum - inputSum) / DsumMax * pSumMaxAlgorithm;
-							}
-                    }
-                }
-				a1[j] = sigmoid(outN1[j]);
-				//da1[j] = round(a1[j] * (param->numInputLevel - 1));
-				da1[j] = round_th(a1[j]*(param->numInputLevel-1), param->Hthreshold);
-			}
+								    outN1[j] += (double)(Dsum - inputSum) / DsumMax * pSumMaxAlgorithm;
+								}
+	                    }
+	                }
+					a1[j] = sigmoid(outN1[j]);
+					//da1[j] = round(a1[j] * (param->numInputLevel - 1));
+					da1[j] = round_th(a1[j]*(param->numInputLevel-1), param->Hthreshold);
+				}
 
-			numBatchReadSynapse = (int)ceil((double)param->nHide/param->numColMuxed);
-			#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
-			for (int j=0; j<param->nHide; j+=numBatchReadSynapse) {
-				int numActiveRows = 0;  // Number of selected rows for NeuroSim
-				for (int n=0; n<param->numBitInput; n++) {
-					for (int k=0; k<param->nInput; k++) {
-						if ((dTestInput[i][k]>>n) & 1) {    // if the nth bit of dTestInput[i][k] is 1
-							numActiveRows++;
-						}
+				numBatchReadSynapse = (int)ceil((double)param->nHide/param->numColMuxed);
+				if (param->deferredNeuroSim) {
+					if (!param->useHardwareInTraining)
+						NeuroSimDeferRead(activityIH, testInputPlane.NumActiveRows(i), (param->nHide + numBatchReadSynapse - 1) / numBatchReadSynapse);
+				} else {
+					#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
+					for (int j=0; j<param->nHide; j+=numBatchReadSynapse) {
+						int numActiveRows = testInputPlane.NumActiveRows(i);  // Number of selected rows for NeuroSim
+						subArrayIH->activityRowRead = (double)numActiveRows/param->nInput/param->numBitInput;
+						double readDynamicEnergy, readLatency;
+						NeuroSimReadPerformance(subArrayIH, numActiveRows, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH, &readDynamicEnergy, &readLatency);
+						sumNeuroSimReadEnergyIH += readDynamicEnergy;
+						sumReadLatencyIH += readLatency;
 					}
 				}
-				subArrayIH->activityRowRead = (double)numActiveRows/param->nInput/param->numBitInput;
-				sumNeuroSimReadEnergyIH += NeuroSimSubArrayReadEnergy(subArrayIH);
-				sumNeuroSimReadEnergyIH += NeuroSimNeuronReadEnergy(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
-				sumReadLatencyIH += NeuroSimSubArrayReadLatency(subArrayIH);
-				sumReadLatencyIH += NeuroSimNeuronReadLatency(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
-			}
-		} else {    // Algorithm
-			for (int j=0; j<param->nHide; j++){
-				for (int k=0; k<param->nInput; k++){
-					outN1[j] += testInput[i][k] * weight1[j][k];
+			} else {    // Algorithm
+				for (int j=0; j<param->nHide; j++){
+					outN1[j] = testOutN1[t - start][j];
+					a1[j] = sigmoid(outN1[j]);
 				}
-				a1[j] = sigmoid(outN1[j]);
 			}
-		}
-
-		/* Second layer from hidden layer to the output layer */
-		tempMax = 0;
-		countNum = 0;
-		std::fill_n(outN2, param->nOutput, 0);
-		std::fill_n(a2, param->nOutput, 0);
-		if (param->useHardwareInTestingFF) {  // Hardware
-			for (int j=0; j<param->nOutput; j++) {
-				if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
-					if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
-						sumArrayReadEnergyHO += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd * param->nHide; // All WLs open
-					}
-				} else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0])) {
-					if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
-						sumArrayReadEnergyHO += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd;  // Selected WL
-					} else {    // Cross-point
-						sumArrayReadEnergyHO += arrayHO->wireCapRow * techHO.vdd * techHO.vdd * (param->nHide - 1); // Unselected WLs
-					}
-				}else if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0]))  // Analog eNVM
-						sumArrayReadEnergyHO += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd * param->nHide; // All WLs open
 
+			/* Second layer from hidden layer to the output layer */
+			tempMax = 0;
+			countNum = 0;
+			std::fill_n(outN2, param->nOutput, 0);
+			std::fill_n(a2, param->nOutput, 0);
+			if (param->useHardwareInTestingFF) {  // Hardware
+				int activeRowsHide[param->numBitInput][param->nHide];  // Rows of arrayHO driven by each bit of da1
+				int numActiveRowsHide[param->numBitInput];
+				unsigned long long activePlaneHide[param->numBitInput][(param->nHide+63)/64];	// The same rows packed as bitsets
 				for (int n=0; n<param->numBitInput; n++) {
-					double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayHO->arrayRowSize;    // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
-					if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog NVM
-						double Isum = 0;    // weighted sum current
-						double IsumMax = 0; // Max weighted sum current
-                        double IsumMin = 0;
-						double a1Sum = 0;   // Weighted sum current of a1 vector * weight=1 column
-						for (int k=0; k<param->nHide; k++) {
-							if ((da1[k]>>n) & 1) {    // if the nth bit of da1[k] is 1
-								Isum += arrayHO->ReadCell(j,k);
-								a1Sum += arrayHO->GetMediumCellReadCurrent(j,k);
+					numActiveRowsHide[n] = InputPlane::FindActiveRows(da1, param->nHide, n, activeRowsHide[n]);
+					InputPlane::PackActiveRows(activeRowsHide[n], numActiveRowsHide[n], (param->nHide+63)/64, activePlaneHide[n]);
+				}
+				for (int j=0; j<param->nOutput; j++) {
+					if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
+						if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
+							sumArrayReadEnergyHO += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd * param->nHide; // All WLs open
+						}
+					} else if (arrayHO->IsDigitalNVM()) {
+						if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
+							sumArrayReadEnergyHO += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd;  // Selected WL
+						} else {    // Cross-point
+							sumArrayReadEnergyHO += arrayHO->wireCapRow * techHO.vdd * techHO.vdd * (param->nHide - 1); // Unselected WLs
+						}
+					}else if (arrayHO->IsAnalogNVM())  // Analog eNVM
+							sumArrayReadEnergyHO += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd * param->nHide; // All WLs open
+
+					for (int n=0; n<param->numBitInput; n++) {
+						double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayHO->arrayRowSize;    // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
+						const int *activeRows = activeRowsHide[n];
+						randomContext.phase = RANDOM_PHASE_TEST_HO + n;
+						int numActiveRows = numActiveRowsHide[n];
+						if (arrayHO->IsAnalogNVM()) {  // Analog NVM
+							double Isum = 0;    // weighted sum current
+							double IsumMax = arrayHO->columnIsumMax[j]; // Max weighted sum current
+							double IsumMin = arrayHO->columnIsumMin[j];
+							double a1Sum = arrayHO->ReferenceColumnCurrent(j, activeRows, numActiveRows);   // Weighted sum current of a1 vector * weight=1 column
+							Isum = arrayHO->ReadColumnCurrent(j, activeRows, numActiveRows);
+							for (int r=0; r<numActiveRows; r++) {    // rows whose nth bit of da1[k] is 1
 								sumArrayReadEnergyHO += arrayHO->wireCapRow * readVoltageHO * readVoltageHO;  
 							}
-							IsumMax += arrayHO->GetMaxCellReadCurrent(j,k);
-                            IsumMin += arrayHO->GetMinCellReadCurrent(j,k);
-						}
-						sumArrayReadEnergyHO += Isum * readVoltageHO * readPulseWidthHO;
-						int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(a1Sum, IsumMax-IsumMin));
-						//int outputDigits = (CurrentToDigits(Isum, IsumMax)-CurrentToDigits(a1Sum, IsumMax));
-						outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);
-                        
-					} else if	(HybridCell *temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0])) {  //3T1C
-                       
-                        double Isum_LSB = 0;              // weighted sum current of the LTP cell
-                        double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
-                        double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
-                        double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
-                        double IsumMin_LSB = 0;
-                        double IsumMax_MSB = 0; 
-                        double IsumMin_MSB = 0;                         
-                        double a1Sum_LSB= 0;      // Reference for LSB cell
-						for (int k=0; k<param->nHide; k++) {
-							if ((da1[k]>>n) & 1) {    // if the nth bit of da1[k] is 1
-                                Isum_LSB += arrayHO->ReadCell(j,k,"LSB");                   // the weight sum of the Jth column
-                                Isum_MSB_LTP += arrayHO->ReadCell(j,k,"MSB_LTP");  
-                                Isum_MSB_LTD += arrayHO->ReadCell(j,k,"MSB_LTD");  
-                                a1Sum_LSB += arrayHO->GetMediumCellReadCurrent(j,k);
-                                sumArrayReadEnergyHO += arrayHO->wireCapRow * readVoltageHO * readVoltageHO; // Selected BLs (1T1R) or Selected WLs (cross-point)
-                                sumArrayReadEnergyHO += 2*arrayHO->wireCapRow * readVoltageMSB * readVoltageMSB; // Selected BLs (1T1R) or Selected WLs (cross-point)
+							sumArrayReadEnergyHO += Isum * readVoltageHO * readPulseWidthHO;
+							int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(a1Sum, IsumMax-IsumMin));
+							//int outputDigits = (CurrentToDigits(Isum, IsumMax)-CurrentToDigits(a1Sum, IsumMax));
+							outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);
+	                        
+						} else if	(arrayHO->IsHybridCell()) {  //3T1C
+	                       
+	                        double Isum_LSB = 0;              // weighted sum current of the LTP cell
+	                        double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
+	                        double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
+	                        double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
+	                        double IsumMin_LSB = 0;
+	                        double IsumMax_MSB = 0; 
+	                        double IsumMin_MSB = 0;                         
+	                        double a1Sum_LSB= 0;      // Reference for LSB cell
+							for (int r=0; r<numActiveRows; r++) {    // rows whose nth bit of da1[k] is 1
+								int k = activeRows[r];
+								Isum_LSB += arrayHO->ReadCell(j,k,"LSB");                   // the weight sum of the Jth column
+								Isum_MSB_LTP += arrayHO->ReadCell(j,k,"MSB_LTP");  
+								Isum_MSB_LTD += arrayHO->ReadCell(j,k,"MSB_LTD");  
+								a1Sum_LSB += arrayHO->GetMediumCellReadCurrent(j,k);
+								sumArrayReadEnergyHO += arrayHO->wireCapRow * readVoltageHO * readVoltageHO; // Selected BLs (1T1R) or Selected WLs (cross-point)
+								sumArrayReadEnergyHO += 2*arrayHO->wireCapRow * readVoltageMSB * readVoltageMSB; // Selected BLs (1T1R) or Selected WLs (cross-point)
 							}
-                            IsumMax_LSB += arrayHO->GetMaxCellReadCurrent(j,k,"LSB");
-                            IsumMax_MSB += arrayHO->GetMaxCellReadCurrent(j,k,"MSB");
-                            IsumMin_LSB += arrayHO->GetMinCellReadCurrent(j,k,"LSB");
-                            IsumMin_MSB += arrayHO->GetMinCellReadCurrent(j,k,"MSB");
-						}                        
-                        sumArrayReadEnergyHO += Isum_LSB * readVoltageHO * readPulseWidthHO;
-                        sumArrayReadEnergyHO += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
-                        int outputDigits;
-                        int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
-                        //int outputDigitsLSB = CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB); //minus the reference
-                        int outputDigitsMSB = CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB); //minus the reference
-                        outputDigits = static_cast<HybridCell*>(arrayHO->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
-                        outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1);; 
-					} 
-                    else 
-                        {// SRAM or digital eNVM
-                            bool digitalNVM = false; 
-                            bool parallelRead = false;
-                            if(DigitalNVM*temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0]))
-                            {    digitalNVM = true;
-                                if(static_cast<DigitalNVM*>(arrayHO->cell[0][0])->parallelRead == true) 
-								{
-                                    parallelRead = true;
-                                }
-                            }
-                            if(digitalNVM && parallelRead)
-                            {
-                                //printf("Calculating the weight for parallel read-out\n");
-                                double Imin = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
-                                double Imax = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
-                                double Isum = 0;    // weighted sum current
-                                double IsumMax = 0; // Max weighted sum current
-                                double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
-                                int Dsum=0;
-                                int DsumMax = 0;
-                                int Dref = 0;
-                                for (int w=0;w<param->numWeightBit;w++){
-                                    int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
-                                    for (int k=0; k<param->nHide; k++) {
-                                        if ((da1[k]>>n) & 1) { // accumulate the current along a column
-                                            Isum += static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->readVoltage;
-                                            //inputSum += Imin;
-                                            inputSum += static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->readVoltage;                                            
-                                        }
-                                    }
-                                    int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column
-                                                                                                               // basically, this is the number of "1" in this column
-                                    int outputDigitsRef = (int) (inputSum/(Imax-Imin));
-                                    
-                                    if(outputDigits > param->pSumMaxHardware)
-                                        outputDigits = param->pSumMaxHardware;
-                                    if(outputDigitsRef > param->pSumMaxHardware)
-                                        outputDigitsRef = param->pSumMaxHardware;
-                                    outputDigits = outputDigits-outputDigitsRef;
- 
-                                    Dref = (int)(inputSum/Imin);
-                                    Isum=0;
-                                    inputSum=0;
-                                    Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
-                                    DsumMax += param->nHide*(int) pow(2,w); // the maximum weight that can be represented by this column                                        
-                                }
-                                sumArrayReadEnergyHO += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
-                                outN2[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
-                            }
-                            else
-                            {                            
-							    int Dsum = 0;
-							    int DsumMax = 0;
-							    int a1Sum = 0;
-							    for (int k=0; k<param->nHide; k++) {
-								    if ((da1[k]>>n) & 1) {    // if the nth bit of da1[k] is 1
-									    Dsum += (int)(arrayHO->ReadCell(j,k));
-									    a1Sum += pow(2, arrayHO->numCellPerSynapse-1) - 1;    // get current of Dummy Column as reference
-								    }
-								    DsumMax += pow(2, arrayHO->numCellPerSynapse) - 1;
-							    } 
-							    if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0])) {    // Digital eNVM
-								    sumArrayReadEnergyHO += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
-							    } 
-                                else {
-								    sumArrayReadEnergyHO += static_cast<SRAM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
-							    }
-							    outN2[j] += (double)(Dsum - a1Sum) / DsumMax * pSumMaxAlgorithm;
-                            }
+							for (int k=0; k<param->nHide; k++) {
+	                            IsumMax_LSB += arrayHO->GetMaxCellReadCurrent(j,k,"LSB");
+	                            IsumMax_MSB += arrayHO->GetMaxCellReadCurrent(j,k,"MSB");
+	                            IsumMin_LSB += arrayHO->GetMinCellReadCurrent(j,k,"LSB");
+	                            IsumMin_MSB += arrayHO->GetMinCellReadCurrent(j,k,"MSB");
+							}                        
+	                        sumArrayReadEnergyHO += Isum_LSB * readVoltageHO * readPulseWidthHO;
+	                        sumArrayReadEnergyHO += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
+	                        int outputDigits;
+	                        int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
+	                        //int outputDigitsLSB = CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB); //minus the reference
+	                        int outputDigitsMSB = CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB); //minus the reference
+	                        outputDigits = static_cast<HybridCell*>(arrayHO->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
+	                        outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1);; 
 						} 
+	                    else 
+	                        {// SRAM or digital eNVM
+	                            bool digitalNVM = false; 
+	                            bool parallelRead = false;
+	                            if(arrayHO->IsDigitalNVM())
+	                            {    digitalNVM = true;
+	                                if(static_cast<DigitalNVM*>(arrayHO->cell[0][0])->parallelRead == true) 
+									{
+	                                    parallelRead = true;
+	                                }
+	                            }
+	                            if(digitalNVM && parallelRead)
+	                            {
+	                                //printf("Calculating the weight for parallel read-out\n");
+	                                double Imin = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
+	                                double Imax = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
+	                                double Isum = 0;    // weighted sum current
+	                                double IsumMax = 0; // Max weighted sum current
+	                                double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
+	                                int Dsum=0;
+	                                int DsumMax = 0;
+	                                int Dref = 0;
+	                                for (int w=0;w<param->numWeightBit;w++){
+	                                    int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
+	                                    for (int r=0; r<numActiveRows; r++) { // accumulate the current along a column
+	                                        int k = activeRows[r];
+	                                        Isum += static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->readVoltage;
+	                                        //inputSum += Imin;
+	                                        inputSum += static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->readVoltage;                                            
+	                                    }
+	                                    int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column
+	                                                                                                               // basically, this is the number of "1" in this column
+	                                    int outputDigitsRef = (int) (inputSum/(Imax-Imin));
+	                                    
+	                                    if(outputDigits > param->pSumMaxHardware)
+	                                        outputDigits = param->pSumMaxHardware;
+	                                    if(outputDigitsRef > param->pSumMaxHardware)
+	                                        outputDigitsRef = param->pSumMaxHardware;
+	                                    outputDigits = outputDigits-outputDigitsRef;
+	 
+	                                    Dref = (int)(inputSum/Imin);
+	                                    Isum=0;
+	                                    inputSum=0;
+	                                    Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
+	                                    DsumMax += param->nHide*(int) pow(2,w); // the maximum weight that can be represented by this column                                        
+	                                }
+	                                sumArrayReadEnergyHO += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
+	                                outN2[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
+	                            }
+	                            else
+	                            {                            
+								    int Dsum = arrayHO->ReadColumnDigits(j, activeRows, numActiveRows, activePlaneHide[n]);    // rows whose nth bit of da1[k] is 1
+								    int DsumMax = param->nHide * ((1 << arrayHO->numCellPerSynapse) - 1);
+								    int a1Sum = numActiveRows * ((1 << (arrayHO->numCellPerSynapse-1)) - 1);    // get current of Dummy Column as reference
+								    if (arrayHO->IsDigitalNVM()) {    // Digital eNVM
+									    sumArrayReadEnergyHO += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
+								    } 
+	                                else {
+									    sumArrayReadEnergyHO += static_cast<SRAM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
+								    }
+								    outN2[j] += (double)(Dsum - a1Sum) / DsumMax * pSumMaxAlgorithm;
+	                            }
+							} 
+					}
+					a2[j] = sigmoid(outN2[j]);
+					if (a2[j] > tempMax) {
+						tempMax = a2[j];
+						countNum = j;
+					}
 				}
-				a2[j] = sigmoid(outN2[j]);
-				if (a2[j] > tempMax) {
-					tempMax = a2[j];
-					countNum = j;
-				}
-			}
 
-			numBatchReadSynapse = (int)ceil((double)param->nOutput/param->numColMuxed);
-			#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
-			for (int j=0; j<param->nOutput; j+=numBatchReadSynapse) {
-				int numActiveRows = 0;  // Number of selected rows for NeuroSim
-				for (int n=0; n<param->numBitInput; n++) {
-					for (int k=0; k<param->nHide; k++) {
-						if ((da1[k]>>n) & 1) {    // if the nth bit of da1[k] is 1
-							numActiveRows++;
+				numBatchReadSynapse = (int)ceil((double)param->nOutput/param->numColMuxed);
+				if (param->deferredNeuroSim) {
+					int numActiveRows = 0;
+					for (int n=0; n<param->numBitInput; n++) {
+						numActiveRows += numActiveRowsHide[n];
+					}
+					if (!param->useHardwareInTraining)
+						NeuroSimDeferRead(activityHO, numActiveRows, (param->nOutput + numBatchReadSynapse - 1) / numBatchReadSynapse);
+				} else {
+					#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
+					for (int j=0; j<param->nOutput; j+=numBatchReadSynapse) {
+						int numActiveRows = 0;  // Number of selected rows for NeuroSim
+						for (int n=0; n<param->numBitInput; n++) {
+							numActiveRows += numActiveRowsHide[n];
 						}
+						subArrayHO->activityRowRead = (double)numActiveRows/param->nHide/param->numBitInput;
+						double readDynamicEnergy, readLatency;
+						NeuroSimReadPerformance(subArrayHO, numActiveRows, adderHO, muxHO, muxDecoderHO, dffHO, subtractorHO, &readDynamicEnergy, &readLatency);
+						sumNeuroSimReadEnergyHO += readDynamicEnergy;
+						sumReadLatencyHO += readLatency;
 					}
 				}
-				subArrayHO->activityRowRead = (double)numActiveRows/param->nHide/param->numBitInput;
-				sumNeuroSimReadEnergyHO += NeuroSimSubArrayReadEnergy(subArrayHO);
-				sumNeuroSimReadEnergyHO += NeuroSimNeuronReadEnergy(subArrayHO, adderHO, muxHO, muxDecoderHO, dffHO, subtractorHO);
-				sumReadLatencyHO += NeuroSimSubArrayReadLatency(subArrayHO);
-				sumReadLatencyHO += NeuroSimNeuronReadLatency(subArrayHO, adderHO, muxHO, muxDecoderHO, dffHO, subtractorHO);
-			}
-		} else {    // Algorithm
-			for (int j=0; j<param->nOutput; j++) {
-				for (int k=0; k<param->nHide; k++) {
-					outN2[j] += a1[k] * weight2[j][k];
-				}
-				a2[j] = sigmoid(outN2[j]);
-				if (a2[j] > tempMax) {
-					tempMax = a2[j];
-					countNum = j;
+			} else {    // Algorithm
+				MatVec(weight2, a1, outN2);
+				for (int j=0; j<param->nOutput; j++) {
+					a2[j] = sigmoid(outN2[j]);
+					if (a2[j] > tempMax) {
+						tempMax = a2[j];
+						countNum = j;
+					}
 				}
 			}
+			if (testOutput[i][countNum] == 1) {
+				correct++;
+			}
 		}
-		if (testOutput[i][countNum] == 1) {
-			correct++;
+		numValidated = end;
+		if (sampled && end < numImages) {
+			/* Agresti-Coull interval with the finite population correction, since the images are drawn without replacement */
+			double z2 = param->validationZ * param->validationZ;
+			double p = (correct + z2/2) / (numValidated + z2);
+			validationHalfWidth = param->validationZ * sqrt(p * (1-p) / (numValidated + z2) * (1 - (double)numValidated / numImages));
+			if (validationHalfWidth <= param->validationTolerance)
+				break;
 		}
 	}
 	if (!param->useHardwareInTraining) {    // Calculate the classification latency and energy only for offline classification
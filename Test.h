@@ -39,6 +39,6 @@
 #ifndef TEST_H_
 #define TEST_H_
 
-void Validate();
+void Validate(bool sampled=false);
 
 #endif
@@ -39,25 +39,31 @@
 #include <cstdio>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <random>
 #include <string>
 #include <cmath>
 #include "formula.h"
 #include "Param.h"
 #include "Array.h"
+#include "DataMatrix.h"
+#include "Gemm.h"
+#include "InputPlane.h"
 #include "Mapping.h"
 #include "NeuroSim.h"
+#include "RNG.h"
 
 extern Param *param;
 
-extern std::vector< std::vector<double> > Input;
-extern std::vector< std::vector<int> > dInput;
-extern std::vector< std::vector<double> > Output;
+extern DataMatrix<double> Input;
+extern DataMatrix<int> dInput;
+extern DataMatrix<double> Output;
+extern InputPlane trainInputPlane;
 
-extern std::vector< std::vector<double> > weight1;
-extern std::vector< std::vector<double> > weight2;
-extern std::vector< std::vector<double> > deltaWeight1;
-extern std::vector< std::vector<double> > deltaWeight2;
+extern DataMatrix<double> weight1;
+extern DataMatrix<double> weight2;
+extern DataMatrix<double> deltaWeight1;
+extern DataMatrix<double> deltaWeight2;
 extern std::vector< std::vector<double> >  totalDeltaWeight1;
 extern std::vector< std::vector<double> >  totalDeltaWeight1_abs;
 extern std::vector< std::vector<double> >  totalDeltaWeight2;
@@ -87,12 +93,13 @@ extern Mux muxHO;
 extern RowDecoder muxDecoderHO;
 extern DFF dffHO;
 extern Subtractor subtractorHO;
+extern NeuroSimActivity activityIH;
+extern NeuroSimActivity activityHO;
 
 extern double totalWeightUpdate=0; // track the total weight update (absolute value) during the whole training process
 extern double totalNumPulse=0;// track the total number of pulse for the weight update process; for Analog device only
 
 /*Optimization functions*/
-double gradt;
 double GAMA=0.3;
 double BETA1= 0.9, BETA2=0.9; 
 double SGD(double gradient, double learning_rate);
@@ -103,9 +110,10 @@ double Adam(double gradient, double learning_rate, double momentumPreV, double v
 void WeightTransfer_2T1F(void);
 void WeightTransfer(void);
 void TransferEnergyLatencyCalculation(Array* array, SubArray* subArray);
+void TrainForward(int i, double *outN1, double *a1, int *da1, double *outN2, double *a2, double *arrayReadEnergyIH, double *arrayReadEnergyHO, int *numActiveRowsHO);
+void TrainReadNeuroSim(int i, int numActiveRowsHO);
 
 void Train(const int numTrain, const int epochs, char *optimization_type) {
-int numBatchReadSynapse;	    // # of read synapses in a batch read operation (decide later)
 int numBatchWriteSynapse;	// # of write synapses in a batch write operation (decide later)
 double outN1[param->nHide]; // Net input to the hidden layer [param->nHide]
 double a1[param->nHide];    // Net output of hidden layer [param->nHide] also the input of hidden layer to output layer
@@ -120,388 +128,62 @@ double s2[param->nOutput];  // Output delta from hidden layer to the output laye
 
 int train_batchsize = param -> numTrainImagesPerBatch;
 
+/* Batched forward pass: the non-SGD hardware training only writes the arrays at the end of a batch */
+bool batchForward = param->useHardwareInTrainingWU && !(optimization_type == "SGD") && train_batchsize > 1;
+int numBatchImages = 0;
+std::vector<int> batchImage(train_batchsize);
+std::vector<double> batchOutN1(batchForward? train_batchsize * param->nHide : 0);
+std::vector<double> batchA1(batchForward? train_batchsize * param->nHide : 0);
+std::vector<int> batchDa1(batchForward? train_batchsize * param->nHide : 0);
+std::vector<double> batchOutN2(batchForward? train_batchsize * param->nOutput : 0);
+std::vector<double> batchA2(batchForward? train_batchsize * param->nOutput : 0);
+std::vector<double> batchReadEnergyIH(train_batchsize);
+std::vector<double> batchReadEnergyHO(train_batchsize);
+std::vector<int> batchNumActiveRowsHO(train_batchsize);
+
 	
 	for (int t = 0; t < epochs; t++) {
 		for (int batchSize = 0; batchSize < numTrain; batchSize++) {
-			int i = rand() % param->numMnistTrainImages;  // Randomize sample
-			/* First layer (input layer to the hidden layer) */
-			std::fill_n(outN1, param->nHide, 0);
-			std::fill_n(a1, param->nHide, 0);
-        if (param->useHardwareInTrainingFF) {   // Hardware
-				double sumArrayReadEnergy = 0;   // Use a temporary variable here since OpenMP does not support reduction on class member
-                double readVoltage;
-                double readVoltageMSB;  // for the hybrid cell
-                double readPulseWidth;
-                double readPulseWidthMSB;   // for the hybrid cell
-           if(AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0]))
-           {
-                 readVoltage = static_cast<eNVM*>(arrayIH->cell[0][0])->readVoltage;
-				 readPulseWidth = static_cast<eNVM*>(arrayIH->cell[0][0])->readPulseWidth;
-           }
-           else if(HybridCell*temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
-           {
-                readVoltage = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.readVoltage;
-				readPulseWidth = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.readPulseWidth; 
-                readVoltageMSB = static_cast<HybridCell*>(arrayIH->cell[0][0])->MSBcell_LTP.readVoltage;
-				readPulseWidthMSB = static_cast<HybridCell*>(arrayIH->cell[0][0])->MSBcell_LTP.readPulseWidth;     
-            }
-            #pragma omp parallel for reduction(+: sumArrayReadEnergy)
-				for (int j=0; j<param->nHide; j++) {
-					if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
-                        if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
-							sumArrayReadEnergy += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput; // All WLs open
-						}
-					} else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0])) { // Digital eNVM
-						if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
-							sumArrayReadEnergy += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd; // Selected WL
-						} else {    // Cross-point
-							sumArrayReadEnergy += arrayIH->wireCapRow * techIH.vdd * techIH.vdd * (param->nInput - 1);  // Unselected WLs
-						}
-					} else if(HybridCell*temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
-                    {   // multiply with 3 because we need to read PCM_LTP, PCM_LTD and 3T1C cell
-                        sumArrayReadEnergy += 3*(arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput); // All WLs open
-                    } 
-                    
-					for (int n=0; n<param->numBitInput; n++) {
-						double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayIH->arrayRowSize;  // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
-							double Isum = 0;    // weighted sum current
-							double IsumMax = 0; // Max weighted sum current
-                            double IsumMin = 0; 
-							double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
-							for (int k=0; k<param->nInput; k++) {
-								if ((dInput[i][k]>>n) & 1) {    // if the nth bit of dInput[i][k] is 1
-									Isum += arrayIH->ReadCell(j,k);
-                                    inputSum += arrayIH->GetMediumCellReadCurrent(j,k);    // get current of Dummy Column as reference
-									sumArrayReadEnergy += arrayIH->wireCapRow * readVoltage * readVoltage; // Selected BLs (1T1R) or Selected WLs (cross-point)
-								}
-								IsumMax += arrayIH->GetMaxCellReadCurrent(j,k);
-                                IsumMin += arrayIH->GetMinCellReadCurrent(j,k);
-							}
-							sumArrayReadEnergy += Isum * readVoltage * readPulseWidth;
-							int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(inputSum, IsumMax-IsumMin));
-                            //int outputDigits = (CurrentToDigits(Isum, IsumMax)-CurrentToDigits(inputSum, IsumMax)); 
-                            outN1[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);
-						}
-                        else if(HybridCell*temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
-                        {
-                            double Isum_LSB = 0;              // weighted sum current of the LTP cell
-							double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
-							double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
-							double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
-                            double IsumMax_MSB = 0; 
-                            double IsumMin_LSB = 0;
-                            double IsumMin_MSB = 0;
-                            double inputSum_LSB= 0;      // Reference for LSB cell
-							for (int k=0; k<param->nInput; k++) 
-                            {
-								if ((dInput[i][k]>>n) & 1) // if the nth bit of dInput[i][k] is 1
-                                {    
-									Isum_LSB += arrayIH->ReadCell(j,k,"LSB");                   // the weight sum of the Jth column
-                                    Isum_MSB_LTP += arrayIH->ReadCell(j,k,"MSB_LTP");  
-                                    Isum_MSB_LTD += arrayIH->ReadCell(j,k,"MSB_LTD");  
-                                    inputSum_LSB += arrayIH->GetMediumCellReadCurrent(j,k);
-									sumArrayReadEnergy += arrayIH->wireCapRow * readVoltage * readVoltage; //
-									sumArrayReadEnergy += 2*arrayIH->wireCapRow * readVoltageMSB * readVoltageMSB; // 
-								}
-								IsumMax_LSB += arrayIH->GetMaxCellReadCurrent(j,k,"LSB");
-								IsumMax_MSB += arrayIH->GetMaxCellReadCurrent(j,k,"MSB");
-								IsumMin_LSB += arrayIH->GetMinCellReadCurrent(j,k,"LSB");
-								IsumMin_MSB += arrayIH->GetMinCellReadCurrent(j,k,"MSB");
-							}
-                            sumArrayReadEnergy += Isum_LSB * readVoltage * readPulseWidth;
-                            sumArrayReadEnergy += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
-                            int outputDigits;
-						    int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(inputSum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
-                            int outputDigitsMSB = (CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB)); //minus the reference
-                            outputDigits = static_cast<HybridCell*>(arrayIH->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
-                            outN1[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1);  
-                        } 
-                        else 
-                        {    // SRAM or digital eNVM
-                            bool digitalNVM = false; 
-                            bool parallelRead = false;
-                            if(DigitalNVM*temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0]))
-                            {    digitalNVM = true;
-                                if(static_cast<DigitalNVM*>(arrayIH->cell[0][0])->parallelRead == true) 
-								{
-                                    parallelRead = true;
-                                }
-                            }
-                            if(digitalNVM && parallelRead) // parallel read-out for DigitalNVM
-                            {
-                                double Imax = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
-                                double Imin = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
-                                double Isum = 0;    // weighted sum current
-                                double IsumMax = 0; // Max weighted sum current
-                                double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
-                                int Dsum=0;
-                                int DsumMax = 0;
-                                int Dref = 0;
-                                for (int w=0;w<param->numWeightBit;w++){
-                                    int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
-                                    for (int k=0; k<param->nInput; k++) 
-                                    {
-                                        if((dInput[i][k]>>n) & 1){ // accumulate the current along a column
-                                            Isum += static_cast<DigitalNVM*>(arrayIH->cell[colIndex][k])->conductance*static_cast<DigitalNVM*>(arrayIH->cell[colIndex ][k])->readVoltage;
-                                            //inputSum += Imin;
-                                            // get the reference current
-                                            inputSum += static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->readVoltage;
-                                        }
-                                    }
-                                    int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column // basically, this is the number of "1" in this column
-                                    int outputDigitsRef = (int) (inputSum/(Imax-Imin));
-                                    outputDigits = outputDigits-outputDigitsRef;
-                                        
-                                    Dref = (int)(inputSum/Imin);
-                                    Isum=0;
-                                    inputSum=0;
-                                    Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
-                                    DsumMax += param->nInput*(int) pow(2,w); // the maximum weight that can be represented by this column
-                                }
-                                sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
-                                outN1[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
-                            }
-                            else
-                            {	 // Digital NVM or SRAM row-by-row readout				
-							    int Dsum = 0;
-							    int DsumMax = 0;
-							    int inputSum = 0;
-							    for (int k=0; k<param->nInput; k++) {
-								    if ((dInput[i][k]>>n) & 1) {    // if the nth bit of dInput[i][k] is 1
-									    Dsum += (int)(arrayIH->ReadCell(j,k));
-									    inputSum += pow(2, arrayIH->numCellPerSynapse-1) - 1;   // get the digital weights of the dummy column as reference
-								    }
-								    DsumMax += pow(2, arrayIH->numCellPerSynapse) - 1;
-							    }
-							    if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0])) {    // Digital eNVM
-								    sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
-							    } 
-                                else {    // SRAM
-								    sumArrayReadEnergy += static_cast<SRAM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
-							    }
-							    outN1[j] += (double)(Dsum - inputSum) / DsumMax * pSumMaxAlgorithm;
-							}
-						}
-					}
-					a1[j] = sigmoid(outN1[j]);
-					da1[j] = round_th(a1[j]*(param->numInputLevel-1), param->Hthreshold);
-				}
-				arrayIH->readEnergy += sumArrayReadEnergy;
-
-				numBatchReadSynapse = (int)ceil((double)param->nHide/param->numColMuxed);
-				// Don't parallelize this loop since there may be update of member variables inside NeuroSim functions
-				for (int j=0; j<param->nHide; j+=numBatchReadSynapse) {
-					int numActiveRows = 0;  // Number of selected rows for NeuroSim
-					for (int n=0; n<param->numBitInput; n++) {
-						for (int k=0; k<param->nInput; k++) {
-							if ((dInput[i][k]>>n) & 1) {    // if the nth bit of dInput[i][k] is 1
-								numActiveRows++;
-							}
-						}
-					}
-					subArrayIH->activityRowRead = (double)numActiveRows/param->nInput/param->numBitInput;
-					subArrayIH->readDynamicEnergy += NeuroSimSubArrayReadEnergy(subArrayIH);
-					subArrayIH->readDynamicEnergy += NeuroSimNeuronReadEnergy(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
-					subArrayIH->readLatency += NeuroSimSubArrayReadLatency(subArrayIH);
-					subArrayIH->readLatency += NeuroSimNeuronReadLatency(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
-				}
-        } 
-        else {    // Algorithm
-				#pragma omp parallel for
-				for (int j = 0; j < param->nHide; j++) {
-					for (int k = 0; k < param->nInput; k++) {
-						outN1[j] += Input[i][k] * weight1[j][k];
-					}
-					a1[j] = sigmoid(outN1[j]);
-				}
-        }
-
-			/* Second layer (hidder layer to the output layer) */
-			std::fill_n(outN2, param->nOutput, 0);
-			std::fill_n(a2, param->nOutput, 0);
-			if (param->useHardwareInTrainingFF) {   // Hardware
-            double sumArrayReadEnergy = 0;  // Use a temporary variable here since OpenMP does not support reduction on class member
-            double readVoltage;
-            double readPulseWidth;
-            double readVoltageMSB;
-            double readPulseWidthMSB;
-            if(AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])){
-                readVoltage = static_cast<eNVM*>(arrayHO->cell[0][0])->readVoltage;
-				readPulseWidth = static_cast<eNVM*>(arrayHO->cell[0][0])->readPulseWidth;
-            }
-            else if(HybridCell*temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0]))
-            {
-                readVoltage = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.readVoltage;
-				readPulseWidth = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.readPulseWidth;
-                readVoltageMSB = static_cast<HybridCell*>(arrayHO->cell[0][0])->MSBcell_LTP.readVoltage;
-				readPulseWidthMSB = static_cast<HybridCell*>(arrayHO->cell[0][0])->MSBcell_LTP.readPulseWidth;             
-            }
-
-                #pragma omp parallel for reduction(+: sumArrayReadEnergy)
-				for (int j=0; j<param->nOutput; j++) {
-					if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
-						if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
-							sumArrayReadEnergy += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd * param->nHide; // All WLs open
-						}
-					} else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0])) { // Digital eNVM
-						if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
-							sumArrayReadEnergy += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd;    // Selected WL
-						} else {    // Cross-point
-							sumArrayReadEnergy += arrayHO->wireCapRow * techHO.vdd * techHO.vdd * (param->nHide - 1);   // Unselected WLs
-						}
+			int i;  // Index of the training image
+			int numActiveRowsHO = 0;    // Number of active rows of the second layer, for NeuroSim
+			if (batchForward) {
+				int b = batchSize % train_batchsize;
+				if (b == 0) {
+					numBatchImages = std::min(train_batchsize, numTrain - batchSize);
+					for (int n = 0; n < numBatchImages; n++) {
+						batchImage[n] = rand() % param->numMnistTrainImages;  // Randomize sample
 					}
-                    else if(HybridCell*temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0]))
-                    {   // multiply with 3 because we need to read PCM_LTP, PCM_LTD and 3T1C cell
-                        sumArrayReadEnergy += 3*(arrayHO->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput); // All WLs open
-                    } 
-                    
-					for (int n=0; n<param->numBitInput; n++) {
-						double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayHO->arrayRowSize;    // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
-							double Isum = 0;    // weighted sum current
-							double IsumMax = 0; // Max weighted sum current
-                            double IsumMin = 0; 
-							double a1Sum = 0;    // Weighted sum current of input vector * weight=1 column                            
-							for (int k=0; k<param->nHide; k++) {
-								if ((da1[k]>>n) & 1) {    // if the nth bit of da1[k] is 1  
-							 		Isum += arrayHO->ReadCell(j,k);
-                                    a1Sum +=arrayHO->GetMediumCellReadCurrent(j,k);
-                                    sumArrayReadEnergy += arrayHO->wireCapRow * readVoltage * readVoltage; // Selected BLs (1T1R) or Selected WLs (cross-point)								                                  
-                                }
-                                IsumMax += arrayHO->GetMaxCellReadCurrent(j,k);
-                                IsumMin += arrayHO->GetMinCellReadCurrent(j,k);
-							}
-							sumArrayReadEnergy += Isum * readVoltage * readPulseWidth;
-							int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(a1Sum, IsumMax-IsumMin)); //minus the reference
-                            outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);     
-						} 
-                        else if( HybridCell*temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0]))
-                        {
-                            double Isum_LSB = 0;              // weighted sum current of the LTP cell
-							double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
-							double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
-							double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
-                            double IsumMin_LSB = 0;
-                            double IsumMax_MSB = 0;
-                            double IsumMin_MSB = 0;
-                            double a1Sum_LSB= 0;      // Reference for LSB cell
-							for (int k=0; k<param->nHide; k++) {
-								if ((da1[k]>>n) & 1) {    // if the nth bit of dInput[i][k] is 1
-                                    Isum_LSB += arrayHO->ReadCell(j,k,"LSB");                   // the weight sum of the Jth column
-                                    Isum_MSB_LTP += arrayHO->ReadCell(j,k,"MSB_LTP");  
-                                    Isum_MSB_LTD += arrayHO->ReadCell(j,k,"MSB_LTD");  
-                                    a1Sum_LSB += arrayHO->GetMediumCellReadCurrent(j,k);
-									sumArrayReadEnergy += arrayHO->wireCapRow * readVoltage * readVoltage; // Selected BLs (1T1R) or Selected WLs (cross-point)
-									sumArrayReadEnergy += 2*arrayHO->wireCapRow * readVoltageMSB * readVoltageMSB; // Selected BLs (1T1R) or Selected WLs (cross-point)
-                                 }
-                                 IsumMax_LSB += arrayHO->GetMaxCellReadCurrent(j,k,"LSB");
-								 IsumMax_MSB += arrayHO->GetMaxCellReadCurrent(j,k,"MSB");
-                                 IsumMin_LSB += arrayHO->GetMinCellReadCurrent(j,k,"LSB");
-                                 IsumMin_MSB += arrayHO->GetMinCellReadCurrent(j,k,"MSB");
-							}
-							sumArrayReadEnergy += Isum_LSB * readVoltage * readPulseWidth;
-                            sumArrayReadEnergy += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
-							int outputDigits;
-                            int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
-                            //int outputDigitsLSB = CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB); //minus the reference
-                            int outputDigitsMSB = (CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB)); //minus the reference
-                            outputDigits = static_cast<HybridCell*>(arrayHO->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
-                            outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1); 
-                         } 
-                        else 
-                        {// SRAM or digital eNVM
-                            bool digitalNVM = false; 
-                            bool parallelRead = false;
-                            if(DigitalNVM*temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0]))
-                            {    digitalNVM = true;
-                                if(static_cast<DigitalNVM*>(arrayHO->cell[0][0])->parallelRead == true) 
-								{
-                                    parallelRead = true;
-                                }
-                            }
-                            if(digitalNVM && parallelRead)
-                            {
-                                double Imin = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
-                                double Imax = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
-                                double Isum = 0;    // weighted sum current
-                                double IsumMax = 0; // Max weighted sum current
-                                double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
-                                int Dsum=0;
-                                int DsumMax = 0;
-                                int Dref = 0;
-                                for (int w=0;w<param->numWeightBit;w++){
-                                    int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
-                                    for (int k=0; k<param->nHide; k++) {
-                                        if ((da1[k]>>n) & 1) { // accumulate the current along a column
-                                            Isum += static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->readVoltage;
-                                            inputSum += static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->readVoltage;                                            
-                                            //inputSum += Imin;
-                                        }
-                                    }
-                                    int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column
-                                    int outputDigitsRef = (int) (inputSum/(Imax-Imin)); // basically, this is the number of "1" in this column
-                                    outputDigits = outputDigits-outputDigitsRef;
-                                            
-                                    Dref = (int)(inputSum/Imin);
-                                    Isum=0;
-                                    inputSum=0;
-                                    Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
-                                    DsumMax += param->nHide*(int) pow(2,w); // the maximum weight that can be represented by this column                                        
-                                }
-                                sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
-                                outN2[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
-                            }
-                            else
-                            {                            
-							    int Dsum = 0;
-							    int DsumMax = 0;
-							    int a1Sum = 0;
-							    for (int k=0; k<param->nHide; k++) {
-								    if ((da1[k]>>n) & 1) {    // if the nth bit of da1[k] is 1
-									    Dsum += (int)(arrayHO->ReadCell(j,k));
-									    a1Sum += pow(2, arrayHO->numCellPerSynapse-1) - 1;    // get current of Dummy Column as reference
-								    }
-								    DsumMax += pow(2, arrayHO->numCellPerSynapse) - 1;
-							    } 
-							    if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0])) {    // Digital eNVM
-								    sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
-							    } 
-                                else {
-								    sumArrayReadEnergy += static_cast<SRAM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
-							    }
-							    outN2[j] += (double)(Dsum - a1Sum) / DsumMax * pSumMaxAlgorithm;
-                            }
-						}
+					/* The conductances only change at the end of a batch, so the forward passes of the whole batch
+					   are done at once here and each crossbar sweep is shared by all images of the batch */
+					#pragma omp parallel for copyin(randomContext)
+					for (int n = 0; n < numBatchImages; n++) {
+						randomContext.image = t * numTrain + batchSize + n;
+						batchReadEnergyIH[n] = 0;
+						batchReadEnergyHO[n] = 0;
+						TrainForward(batchImage[n], &batchOutN1[n * param->nHide], &batchA1[n * param->nHide], &batchDa1[n * param->nHide],
+								&batchOutN2[n * param->nOutput], &batchA2[n * param->nOutput], &batchReadEnergyIH[n], &batchReadEnergyHO[n], &batchNumActiveRowsHO[n]);
 					}
-					a2[j] = sigmoid(outN2[j]);
-				}
-				arrayHO->readEnergy += sumArrayReadEnergy;
-				numBatchReadSynapse = (int)ceil((double)param->nOutput/param->numColMuxed);
-				// Don't parallelize this loop since there may be update of member variables inside NeuroSim functions
-				for (int j=0; j<param->nOutput; j+=numBatchReadSynapse) {
-					int numActiveRows = 0;  // Number of selected rows for NeuroSim
-					for (int n=0; n<param->numBitInput; n++) {
-						for (int k=0; k<param->nHide; k++) {
-							if ((da1[k]>>n) & 1) {    // if the nth bit of da1[k] is 1
-								numActiveRows++;
-							}
-						}
-					}
-					subArrayHO->activityRowRead = (double)numActiveRows/param->nHide/param->numBitInput;
-					subArrayHO->readDynamicEnergy += NeuroSimSubArrayReadEnergy(subArrayHO);
-					subArrayHO->readDynamicEnergy += NeuroSimNeuronReadEnergy(subArrayHO, adderHO, muxHO, muxDecoderHO, dffHO, subtractorHO);
-					subArrayHO->readLatency += NeuroSimSubArrayReadLatency(subArrayHO);
-					subArrayHO->readLatency += NeuroSimNeuronReadLatency(subArrayHO, adderHO, muxHO, muxDecoderHO, dffHO, subtractorHO);
 				}
+				i = batchImage[b];
+				randomContext.image = t * numTrain + batchSize;
+				std::copy(&batchOutN1[b * param->nHide], &batchOutN1[(b+1) * param->nHide], outN1);
+				std::copy(&batchA1[b * param->nHide], &batchA1[(b+1) * param->nHide], a1);
+				std::copy(&batchDa1[b * param->nHide], &batchDa1[(b+1) * param->nHide], da1);
+				std::copy(&batchOutN2[b * param->nOutput], &batchOutN2[(b+1) * param->nOutput], outN2);
+				std::copy(&batchA2[b * param->nOutput], &batchA2[(b+1) * param->nOutput], a2);
+				arrayIH->readEnergy += batchReadEnergyIH[b];
+				arrayHO->readEnergy += batchReadEnergyHO[b];
+				numActiveRowsHO = batchNumActiveRowsHO[b];
 			} else {
-				#pragma omp parallel for
-				for (int j = 0; j < param->nOutput; j++) {
-					for (int k = 0; k < param->nHide; k++) {
-						outN2[j] += a1[k] * weight2[j][k];
-					}
-					a2[j] = sigmoid(outN2[j]);
-				}
+				i = rand() % param->numMnistTrainImages;  // Randomize sample
+				randomContext.image = t * numTrain + batchSize;
+				double readEnergyIH = 0, readEnergyHO = 0;
+				TrainForward(i, outN1, a1, da1, outN2, a2, &readEnergyIH, &readEnergyHO, &numActiveRowsHO);
+				arrayIH->readEnergy += readEnergyIH;
+				arrayHO->readEnergy += readEnergyHO;
+			}
+			if (param->useHardwareInTrainingFF) {
+				TrainReadNeuroSim(i, numActiveRowsHO);
 			}
 
 			// Backpropagation
@@ -511,13 +193,11 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 			}
 
 			/* First layer (input layer to the hidden layer) */
-			std::fill_n(s1, param->nHide, 0);
-			#pragma omp parallel for
+			double sigmoidDerivative[param->nHide];	// Derivative of the sigmoid at the hidden layer
 			for (int j = 0; j < param->nHide; j++) {
-				for (int k = 0; k < param->nOutput; k++) {
-					s1[j] += a1[j] * (1 - a1[j]) * weight2[k][j] * s2[k];
-				}
+				sigmoidDerivative[j] = a1[j] * (1 - a1[j]);
 			}
+			MatVecTransposed(weight2, s2, sigmoidDerivative, s1);
 
 			// Weight update
 			/* Update weight of the first layer (input layer to the hidden layer) */
@@ -530,20 +210,23 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                 double writeVoltageLTD = static_cast<eNVM*>(arrayIH->cell[0][0])->writeVoltageLTD;
                 double writePulseWidthLTP = static_cast<eNVM*>(arrayIH->cell[0][0])->writePulseWidthLTP;
                 double writePulseWidthLTD = static_cast<eNVM*>(arrayIH->cell[0][0])->writePulseWidthLTD;
-                if(eNVM *temp = dynamic_cast<eNVM*>(arrayIH->cell[0][0])){
+                if(arrayIH->IseNVM()){
                     writeVoltageLTP = static_cast<eNVM*>(arrayIH->cell[0][0])->writeVoltageLTP;
                     writeVoltageLTD = static_cast<eNVM*>(arrayIH->cell[0][0])->writeVoltageLTD;
 				    writePulseWidthLTP = static_cast<eNVM*>(arrayIH->cell[0][0])->writePulseWidthLTP;
 				    writePulseWidthLTD = static_cast<eNVM*>(arrayIH->cell[0][0])->writePulseWidthLTD;
                 }
-                else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0])){
+                else if(arrayIH->IsHybridCell()){
                      writeVoltageLTP = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.writeVoltageLTP;
                      writeVoltageLTD = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.writeVoltageLTD;
                      writePulseWidthLTP = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.writePulseWidthLTP;
                     writePulseWidthLTD = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.writePulseWidthLTD;               
                 }
                 numBatchWriteSynapse = (int)ceil((double)arrayIH->arrayColSize / param->numWriteColMuxed);
-				#pragma omp parallel for reduction(+: sumArrayWriteEnergy, sumNeuroSimWriteEnergy, sumWriteLatencyAnalogNVM)
+				randomContext.phase = RANDOM_PHASE_UPDATE_IH;
+				bool deferNeuroSimWrite = param->deferredNeuroSim && !(arrayIH->IsAnalogNVM() && static_cast<AnalogNVM*>(arrayIH->cell[0][0])->nonIdenticalPulse);	// The RMS row write voltage of non-identical pulses cannot be binned
+				std::vector<int> rowNumWritePulse(param->nInput), rowNumWriteOperation(param->nInput), rowNumWriteCell(param->nInput);	// Per-row statistics for the deferred NeuroSim accounting
+				#pragma omp parallel for reduction(+: sumArrayWriteEnergy, sumNeuroSimWriteEnergy, sumWriteLatencyAnalogNVM) copyin(randomContext)
 				for (int k = 0; k < param->nInput; k++) {
 					int numWriteOperationPerRow = 0;	// Number of write batches in a row that have any weight change
 					int numWriteCellPerOperation = 0;	// Average number of write cells per batch in a row (for digital eNVM)
@@ -563,7 +246,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                         double actualWeightUpdated;
                         for (int jj = start; jj <= end; jj++) { // Selected cells
                             /*can support multiple optimization algorithm*/
-                            gradt = s1[jj] * Input[i][k];
+                            double gradt = s1[jj] * Input[i][k];	// Per-thread, so the update does not depend on the thread count
                             gradSum1[jj][k] += gradt; // sum over the gradient over all the training samples in this batch
                             if (optimization_type == "SGD"){
                                 deltaWeight1[jj][k] = SGD(gradt, param->alpha1);                        
@@ -613,21 +296,21 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                             }
                             
                             if(optimization_type == "SGD" || (batchSize+1) % train_batchsize == 0 ){
-                                if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[jj][k])) {	// Analog eNVM
+                                if (arrayIH->IsAnalogNVM()) {	// Analog eNVM
                                     arrayIH->WriteCell(jj, k, deltaWeight1[jj][k], weight1[jj][k], param->maxWeight, param->minWeight, true);
                                     weight1[jj][k] = arrayIH->ConductanceToWeight(jj, k, param->maxWeight, param->minWeight); 
-                                    weightChangeBatch = weightChangeBatch || static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->numPulse;
-                                    if(fabs(static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->numPulse) > maxPulseNum)
+                                    weightChangeBatch = weightChangeBatch || arrayIH->GetNumPulse(jj, k);
+                                    if(fabs(arrayIH->GetNumPulse(jj, k)) > maxPulseNum)
                                     {
-                                        maxPulseNum=fabs(static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->numPulse);
+                                        maxPulseNum=fabs(arrayIH->GetNumPulse(jj, k));
                                     }
                                     /* Get maxLatencyLTP and maxLatencyLTD */
-                                    if (static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->writeLatencyLTP > maxLatencyLTP)
-                                        maxLatencyLTP = static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->writeLatencyLTP;
-                                    if (static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->writeLatencyLTD > maxLatencyLTD)
-                                        maxLatencyLTD = static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->writeLatencyLTD;
+                                    if (arrayIH->GetWriteLatencyLTP(jj, k) > maxLatencyLTP)
+                                        maxLatencyLTP = arrayIH->GetWriteLatencyLTP(jj, k);
+                                    if (arrayIH->GetWriteLatencyLTD(jj, k) > maxLatencyLTD)
+                                        maxLatencyLTD = arrayIH->GetWriteLatencyLTD(jj, k);
                                 }							
-                                else if (HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[jj][k])) {	// Analog eNVM
+                                else if (arrayIH->IsHybridCell()) {	// Analog eNVM
                                     arrayIH->WriteCell(jj, k, deltaWeight1[jj][k], weight1[jj][k], param->maxWeight, param->minWeight, true);
                                     weight1[jj][k] = arrayIH->ConductanceToWeight(jj, k, param->maxWeight, param->minWeight);
                                     weightChangeBatch = weightChangeBatch || static_cast<HybridCell*>(arrayIH->cell[jj][k])->LSBcell.numPulse;
@@ -655,10 +338,8 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                         
 						numWriteOperationPerRow += weightChangeBatch;
 						for (int jj = start; jj <= end; jj++) { // Selected cells
-							if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
-								/* Set the max latency for all the selected cells in this batch */
-								static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->writeLatencyLTP = maxLatencyLTP;
-								static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->writeLatencyLTD = maxLatencyLTD;
+							if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
+								/* The max latency of this batch applies to all the selected cells (see CellWriteEnergy) */
 								if (param->writeEnergyReport && weightChangeBatch) {
 									if (static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->nonIdenticalPulse) {	// Non-identical write pulse scheme
 										if (static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->numPulse > 0) {	// LTP
@@ -672,15 +353,14 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 											static_cast<eNVM*>(arrayIH->cell[jj][k])->writeVoltageLTD = static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->VinitLTD + 0.5 * static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->VstepLTD * static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->maxNumLevelLTD;    // Use average voltage of LTD write voltage
 										}
 									}
-									static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->WriteEnergyCalculation(arrayIH->wireCapCol);
-									sumArrayWriteEnergy += static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->writeEnergy; 
+									sumArrayWriteEnergy += arrayIH->CellWriteEnergy(jj, k, maxLatencyLTP, maxLatencyLTD);
                                     // add the transfer energy if this is a 2T1F cell
                                     // the transfer energy will be 0 if there is no transfer
-                                    if(_2T1F* temp = dynamic_cast<_2T1F*>(arrayIH->cell[jj][k]))
+                                    if(arrayIH->Is2T1F())
                                         sumArrayWriteEnergy += static_cast<_2T1F*>(arrayIH->cell[jj][k])->transWriteEnergy;
 								}
 							} 
-                            else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
+                            else if(arrayIH->IsHybridCell())
                             {
  								/* Set the max latency for all the selected cells in this batch */
 								static_cast<HybridCell*>(arrayIH->cell[jj][k])->LSBcell.writeLatencyLTP = maxLatencyLTP;
@@ -691,7 +371,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 									sumArrayWriteEnergy += static_cast<HybridCell*>(arrayIH->cell[jj][k])->writeEnergy;
 								}                               
                             }
-                            else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0])) { // Digital eNVM
+                            else if (arrayIH->IsDigitalNVM()) { // Digital eNVM
 								if (param->writeEnergyReport && arrayIH->weightChange[jj][k]) {
 									for (int n=0; n<arrayIH->numCellPerSynapse; n++) {  // n=0 is LSB
 										sumArrayWriteEnergy += static_cast<DigitalNVM*>(arrayIH->cell[(jj+1) * arrayIH->numCellPerSynapse - (n+1)][k])->writeEnergy;
@@ -710,14 +390,14 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 						}
                         
 						/* Latency for each batch write in Analog eNVM */
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {	// Analog eNVM
+						if (arrayIH->IsAnalogNVM()) {	// Analog eNVM
 							sumWriteLatencyAnalogNVM += maxLatencyLTP + maxLatencyLTD;
 						}
-                        else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0])){ // HybridCell
+                        else if(arrayIH->IsHybridCell()){ // HybridCell
  							sumWriteLatencyAnalogNVM += maxLatencyLTP + maxLatencyLTD;
                         }
 						/* Energy consumption on array caps for eNVM */
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
+						if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
 							if (param->writeEnergyReport && weightChangeBatch) {
 								if (static_cast<AnalogNVM*>(arrayIH->cell[0][0])->nonIdenticalPulse) { // Non-identical write pulse scheme
 									writeVoltageLTP = static_cast<AnalogNVM*>(arrayIH->cell[0][0])->VinitLTP + 0.5 * static_cast<AnalogNVM*>(arrayIH->cell[0][0])->VstepLTP * static_cast<AnalogNVM*>(arrayIH->cell[0][0])->maxNumLevelLTP;    // Use average voltage of LTP write voltage
@@ -738,7 +418,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 								}
 							}
 						}
-						else if (HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0])) {  // Hybridcell
+						else if (arrayIH->IsHybridCell()) {  // Hybridcell
 							if (param->writeEnergyReport && weightChangeBatch) {
 									// The energy on selected SLs is included in WriteCell()
 									sumArrayWriteEnergy += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * 2;   // Selected WL (*2 means both LTP and LTD phases)
@@ -747,7 +427,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 									// No LTD part because all unselected rows and columns are V=0
                             }
                         }
-                        else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0])) { // Digital eNVM
+                        else if (arrayIH->IsDigitalNVM()) { // Digital eNVM
 							if (param->writeEnergyReport && weightChangeBatch) {
 								if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
 									// The energy on selected columns is included in WriteCell()
@@ -762,7 +442,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 							}
 						}
 						/* Half-selected cells for eNVM */
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
+						if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
 							if (!static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess && param->writeEnergyReport) { // Cross-point
 								for (int jj = 0; jj < param->nHide; jj++) { // Half-selected cells in the same row
 									if (jj >= start && jj <= end) { continue; } // Skip the selected cells
@@ -776,7 +456,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 									}
 								}
 							}
-						} else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayIH->cell[0][0])) { // Digital eNVM
+						} else if (arrayIH->IsDigitalNVM()) { // Digital eNVM
 							if (!static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess && param->writeEnergyReport && weightChangeBatch) { // Cross-point
 								for (int jj = 0; jj < param->nHide; jj++) {    // Half-selected synapses in the same row
 									if (jj >= start && jj <= end) { continue; } // Skip the selected synapses
@@ -798,43 +478,63 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 							}
 						}
 					}
-					/* Calculate the average number of write pulses on the selected row */
-					#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
-					{
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayIH->cell[0][0])) {  // Analog eNVM
+					if (deferNeuroSimWrite) {	// Only record the row statistics, NeuroSimFlushActivity evaluates them
+						int numWritePulse = subArrayIH->numWritePulse;
+						if (arrayIH->IsAnalogNVM() || arrayIH->IsHybridCell()) {
 							int sumNumWritePulse = 0;
 							for (int j = 0; j < param->nHide; j++) {
-								sumNumWritePulse += abs(static_cast<AnalogNVM*>(arrayIH->cell[j][k])->numPulse);    // Note that LTD has negative pulse number
+								sumNumWritePulse += abs(arrayIH->IsHybridCell()? static_cast<HybridCell*>(arrayIH->cell[j][k])->LSBcell.numPulse : arrayIH->GetNumPulse(j, k));    // Note that LTD has negative pulse number
 							}
-							subArrayIH->numWritePulse = sumNumWritePulse / param->nHide;
-							double writeVoltageSquareSumRow = 0;
-							if (param->writeEnergyReport) {
-								if (static_cast<AnalogNVM*>(arrayIH->cell[0][0])->nonIdenticalPulse) { // Non-identical write pulse scheme
-									for (int j = 0; j < param->nHide; j++) {
-										writeVoltageSquareSumRow += static_cast<AnalogNVM*>(arrayIH->cell[j][k])->writeVoltageSquareSum;
-									}
-									if (sumNumWritePulse > 0) {	// Prevent division by 0
-										subArrayIH->cell.writeVoltage = sqrt(writeVoltageSquareSumRow / sumNumWritePulse);	// RMS value of write voltage in a row
-									} else {
-										subArrayIH->cell.writeVoltage = 0;
+							numWritePulse = sumNumWritePulse / param->nHide;
+						}
+						rowNumWritePulse[k] = numWritePulse;
+						rowNumWriteOperation[k] = numWriteOperationPerRow;
+						rowNumWriteCell[k] = (double)numWriteCellPerOperation/numWriteOperationPerRow;
+					} else {
+						/* Calculate the average number of write pulses on the selected row */
+						#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
+						{
+							if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
+								int sumNumWritePulse = 0;
+								for (int j = 0; j < param->nHide; j++) {
+									sumNumWritePulse += abs(arrayIH->GetNumPulse(j, k));    // Note that LTD has negative pulse number
+								}
+								subArrayIH->numWritePulse = sumNumWritePulse / param->nHide;
+								double writeVoltageSquareSumRow = 0;
+								if (param->writeEnergyReport) {
+									if (static_cast<AnalogNVM*>(arrayIH->cell[0][0])->nonIdenticalPulse) { // Non-identical write pulse scheme
+										for (int j = 0; j < param->nHide; j++) {
+											writeVoltageSquareSumRow += static_cast<AnalogNVM*>(arrayIH->cell[j][k])->writeVoltageSquareSum;
+										}
+										if (sumNumWritePulse > 0) {	// Prevent division by 0
+											subArrayIH->cell.writeVoltage = sqrt(writeVoltageSquareSumRow / sumNumWritePulse);	// RMS value of write voltage in a row
+										} else {
+											subArrayIH->cell.writeVoltage = 0;
+										}
 									}
 								}
 							}
-						}
-                        else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
-                        {
-							int sumNumWritePulse = 0;
-							for (int j = 0; j < param->nHide; j++) {
-								sumNumWritePulse += abs(static_cast<HybridCell*>(arrayIH->cell[j][k])->LSBcell.numPulse);    // Note that LTD has negative pulse number
-							}
-							subArrayIH->numWritePulse = sumNumWritePulse / param->nHide;
-                        }
-						numWriteCellPerOperation = (double)numWriteCellPerOperation/numWriteOperationPerRow;
-						sumNeuroSimWriteEnergy += NeuroSimSubArrayWriteEnergy(subArrayIH, numWriteOperationPerRow, numWriteCellPerOperation);
+	                        else if(arrayIH->IsHybridCell())
+	                        {
+								int sumNumWritePulse = 0;
+								for (int j = 0; j < param->nHide; j++) {
+									sumNumWritePulse += abs(static_cast<HybridCell*>(arrayIH->cell[j][k])->LSBcell.numPulse);    // Note that LTD has negative pulse number
+								}
+								subArrayIH->numWritePulse = sumNumWritePulse / param->nHide;
+	                        }
+							numWriteCellPerOperation = (double)numWriteCellPerOperation/numWriteOperationPerRow;
+							sumNeuroSimWriteEnergy += NeuroSimSubArrayWriteEnergy(subArrayIH, numWriteOperationPerRow, numWriteCellPerOperation);
 
+						}
 					}
 					numWriteOperation += numWriteOperationPerRow;
-                    sumNeuroSimWriteEnergy += NeuroSimSubArrayWriteEnergy(subArrayIH, numWriteOperationPerRow, numWriteCellPerOperation);
+					if (!deferNeuroSimWrite)
+						sumNeuroSimWriteEnergy += NeuroSimSubArrayWriteEnergy(subArrayIH, numWriteOperationPerRow, numWriteCellPerOperation);
+				}
+				if (deferNeuroSimWrite) {
+					for (int k = 0; k < param->nInput; k++) {
+						NeuroSimDeferWrite(activityIH, rowNumWritePulse[k], rowNumWriteOperation[k], rowNumWriteCell[k], 2);	// Each row is counted twice, as in the per-row path above
+					}
 				}
 				if(!std::isnan(sumArrayWriteEnergy)){
     				arrayIH->writeEnergy += sumArrayWriteEnergy;
@@ -843,19 +543,11 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 				numWriteOperation = numWriteOperation / param->nInput;
 				subArrayIH->writeLatency += NeuroSimSubArrayWriteLatency(subArrayIH, numWriteOperation, sumWriteLatencyAnalogNVM);
 			} else {
-				#pragma omp parallel for
-				for (int j = 0; j < param->nHide; j++) {
-					for (int k = 0; k < param->nInput; k++) {
-						deltaWeight1[j][k] = - param->alpha1 * s1[j] * Input[i][k];
-						weight1[j][k] = weight1[j][k] + deltaWeight1[j][k];
-						if (weight1[j][k] > param->maxWeight) {
-							deltaWeight1[j][k] -= weight1[j][k] - param->maxWeight;
-							weight1[j][k] = param->maxWeight;
-						} else if (weight1[j][k] < param->minWeight) {
-							deltaWeight1[j][k] += param->minWeight - weight1[j][k];
-							weight1[j][k] = param->minWeight;
-						}
-						if (param->useHardwareInTrainingFF) {
+				OuterProductUpdate(-param->alpha1, s1, Input[i], deltaWeight1, weight1, param->minWeight, param->maxWeight);
+				if (param->useHardwareInTrainingFF) {
+					#pragma omp parallel for
+					for (int j = 0; j < param->nHide; j++) {
+						for (int k = 0; k < param->nInput; k++) {
 							arrayIH->WriteCell(j, k, deltaWeight1[j][k], weight1[j][k], param->maxWeight, param->minWeight, false);
 						}
 					}
@@ -872,20 +564,23 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                 double writeVoltageLTD;
                 double writePulseWidthLTP;
                 double writePulseWidthLTD;				
-                if(eNVM *temp = dynamic_cast<eNVM*>(arrayHO->cell[0][0])){
+                if(arrayHO->IseNVM()){
                      writeVoltageLTP = static_cast<eNVM*>(arrayHO->cell[0][0])->writeVoltageLTP;
 				     writeVoltageLTD = static_cast<eNVM*>(arrayHO->cell[0][0])->writeVoltageLTD;
 				     writePulseWidthLTP = static_cast<eNVM*>(arrayHO->cell[0][0])->writePulseWidthLTP;
 				     writePulseWidthLTD = static_cast<eNVM*>(arrayHO->cell[0][0])->writePulseWidthLTD;
                 }
-                else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0])){
+                else if(arrayHO->IsHybridCell()){
                      writeVoltageLTP = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.writeVoltageLTP;
 				     writeVoltageLTD = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.writeVoltageLTD;
 				     writePulseWidthLTP = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.writePulseWidthLTP;
 				     writePulseWidthLTD = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.writePulseWidthLTD;               
                 }
 				numBatchWriteSynapse = (int)ceil((double)arrayHO->arrayColSize / param->numWriteColMuxed);
-				#pragma omp parallel for reduction(+: sumArrayWriteEnergy, sumNeuroSimWriteEnergy, sumWriteLatencyAnalogNVM)
+				randomContext.phase = RANDOM_PHASE_UPDATE_HO;
+				bool deferNeuroSimWrite = param->deferredNeuroSim && !(arrayHO->IsAnalogNVM() && static_cast<AnalogNVM*>(arrayHO->cell[0][0])->nonIdenticalPulse);	// The RMS row write voltage of non-identical pulses cannot be binned
+				std::vector<int> rowNumWritePulse(param->nHide), rowNumWriteOperation(param->nHide), rowNumWriteCell(param->nHide);	// Per-row statistics for the deferred NeuroSim accounting
+				#pragma omp parallel for reduction(+: sumArrayWriteEnergy, sumNeuroSimWriteEnergy, sumWriteLatencyAnalogNVM) copyin(randomContext)
 				for (int k = 0; k < param->nHide; k++) {
 					int numWriteOperationPerRow = 0;    // Number of write batches in a row that have any weight change
 					int numWriteCellPerOperation = 0;   // Average number of write cells per batch in a row (for digital eNVM)
@@ -906,7 +601,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                         for (int jj = start; jj <= end; jj++) { // Selected cells
 
 							// deltaWeight2[jj][k] = -param->alpha2 * s2[jj] * a1[k];
-                            gradt = s2[jj] * a1[k];
+                            double gradt = s2[jj] * a1[k];
                             gradSum2[jj][k] += gradt; // sum over the gradient over all the training samples in this batch
                          if (optimization_type == "SGD") 
                             deltaWeight2[jj][k] = SGD(gradt, param->alpha2); 
@@ -953,21 +648,21 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                                 maxWeightUpdated =fabs(actualWeightUpdated);
                             }		
                         if(optimization_type == "SGD" || (batchSize+1) % train_batchsize == 0){
-							if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[jj][k])) { // Analog eNVM
+							if (arrayHO->IsAnalogNVM()) { // Analog eNVM
                                 arrayHO->WriteCell(jj, k, deltaWeight2[jj][k], weight2[jj][k], param->maxWeight, param->minWeight, true);
 							    weight2[jj][k] = arrayHO->ConductanceToWeight(jj, k, param->maxWeight, param->minWeight);
-								weightChangeBatch = weightChangeBatch || static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->numPulse;
-                                if(fabs(static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->numPulse) > maxPulseNum)
+								weightChangeBatch = weightChangeBatch || arrayHO->GetNumPulse(jj, k);
+                                if(fabs(arrayIH->GetNumPulse(jj, k)) > maxPulseNum)
                                 {
-                                    maxPulseNum=fabs(static_cast<AnalogNVM*>(arrayIH->cell[jj][k])->numPulse);
+                                    maxPulseNum=fabs(arrayIH->GetNumPulse(jj, k));
                                 }
                                 /* Get maxLatencyLTP and maxLatencyLTD */
-								if (static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->writeLatencyLTP > maxLatencyLTP)
-									maxLatencyLTP = static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->writeLatencyLTP;
-								if (static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->writeLatencyLTD > maxLatencyLTD)
-									maxLatencyLTD = static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->writeLatencyLTD;
+								if (arrayHO->GetWriteLatencyLTP(jj, k) > maxLatencyLTP)
+									maxLatencyLTP = arrayHO->GetWriteLatencyLTP(jj, k);
+								if (arrayHO->GetWriteLatencyLTD(jj, k) > maxLatencyLTD)
+									maxLatencyLTD = arrayHO->GetWriteLatencyLTD(jj, k);
 							}
-                            else if (HybridCell *temp = dynamic_cast<HybridCell*>(arrayHO->cell[jj][k])) {	// Analog eNVM
+                            else if (arrayHO->IsHybridCell()) {	// Analog eNVM
                                 arrayHO->WriteCell(jj, k, deltaWeight2[jj][k], weight2[jj][k], param->maxWeight, param->minWeight, true);
                                 weight2[jj][k] = arrayHO->ConductanceToWeight(jj, k, param->maxWeight, param->minWeight);
                                 weightChangeBatch = weightChangeBatch || static_cast<HybridCell*>(arrayHO->cell[jj][k])->LSBcell.numPulse;
@@ -995,10 +690,8 @@ int train_batchsize = param -> numTrainImagesPerBatch;
                         /* Latency for each batch write in Analog eNVM */
 						numWriteOperationPerRow += weightChangeBatch;
 						for (int jj = start; jj <= end; jj++) { // Selected cells
-							if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
-								/* Set the max latency for all the cells in this batch */
-								static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->writeLatencyLTP = maxLatencyLTP;
-								static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->writeLatencyLTD = maxLatencyLTD;
+							if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
+								/* The max latency of this batch applies to all the selected cells (see CellWriteEnergy) */
 								if (param->writeEnergyReport && weightChangeBatch) {
 									if (static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->nonIdenticalPulse) { // Non-identical write pulse scheme
 										if (static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->numPulse > 0) {  // LTP
@@ -1012,13 +705,12 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 											static_cast<eNVM*>(arrayHO->cell[jj][k])->writeVoltageLTD = static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->VinitLTD + 0.5 * static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->VstepLTD * static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->maxNumLevelLTD;    // Use average voltage of LTD write voltage
 										}
 									}
-									static_cast<AnalogNVM*>(arrayHO->cell[jj][k])->WriteEnergyCalculation(arrayHO->wireCapCol);
-									sumArrayWriteEnergy += static_cast<eNVM*>(arrayHO->cell[jj][k])->writeEnergy;
-                                    if(_2T1F* temp = dynamic_cast<_2T1F*>(arrayHO->cell[jj][k]))
+									sumArrayWriteEnergy += arrayHO->CellWriteEnergy(jj, k, maxLatencyLTP, maxLatencyLTD);
+                                    if(arrayHO->Is2T1F())
                                         sumArrayWriteEnergy += static_cast<_2T1F*>(arrayHO->cell[jj][k])->transWriteEnergy;
 								}
 							}
-                            else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0]))
+                            else if(arrayHO->IsHybridCell())
                             {
  								/* Set the max latency for all the selected cells in this batch */
 								static_cast<HybridCell*>(arrayHO->cell[jj][k])->LSBcell.writeLatencyLTP = maxLatencyLTP;
@@ -1029,7 +721,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 									sumArrayWriteEnergy += static_cast<HybridCell*>(arrayHO->cell[jj][k])->writeEnergy;
 								}                               
                             } 
-                            else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0])) { // Digital eNVM
+                            else if (arrayHO->IsDigitalNVM()) { // Digital eNVM
 								if (param->writeEnergyReport && arrayHO->weightChange[jj][k]) {
 									for (int n=0; n<arrayHO->numCellPerSynapse; n++) {  // n=0 is LSB
 										sumArrayWriteEnergy += static_cast<DigitalNVM*>(arrayHO->cell[(jj+1) * arrayHO->numCellPerSynapse - (n+1)][k])->writeEnergy;
@@ -1047,14 +739,14 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 							}
 						}
 						/* Latency for each batch write in Analog eNVM */
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
+						if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
 							sumWriteLatencyAnalogNVM += maxLatencyLTP + maxLatencyLTD;
 						}
-                        else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0])){ // HybridCell
+                        else if(arrayIH->IsHybridCell()){ // HybridCell
  							sumWriteLatencyAnalogNVM += maxLatencyLTP + maxLatencyLTD;
                         }
 						/* Energy consumption on array caps for eNVM */
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
+						if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
 							if (param->writeEnergyReport && weightChangeBatch) {
 								if (static_cast<AnalogNVM*>(arrayHO->cell[0][0])->nonIdenticalPulse) { // Non-identical write pulse scheme
 									writeVoltageLTP = static_cast<AnalogNVM*>(arrayHO->cell[0][0])->VinitLTP + 0.5 * static_cast<AnalogNVM*>(arrayHO->cell[0][0])->VstepLTP * static_cast<AnalogNVM*>(arrayHO->cell[0][0])->maxNumLevelLTP;    // Use average voltage of LTP write voltage
@@ -1075,7 +767,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 								}
 							}
 						}
-						else if (HybridCell *temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0])) {  // Hybridcell
+						else if (arrayHO->IsHybridCell()) {  // Hybridcell
 							if (param->writeEnergyReport && weightChangeBatch) {
 									// The energy on selected SLs is included in WriteCell()
 									sumArrayWriteEnergy += arrayHO->wireGateCapRow * techIH.vdd * techIH.vdd * 2;   // Selected WL (*2 means both LTP and LTD phases)
@@ -1084,7 +776,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 									// No LTD part because all unselected rows and columns are V=0
                             }
                         } 
-                        else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0])) { // Digital eNVM
+                        else if (arrayHO->IsDigitalNVM()) { // Digital eNVM
 							if (param->writeEnergyReport && weightChangeBatch) {
 								if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
 									// The energy on selected columns is included in WriteCell()
@@ -1099,7 +791,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 							}
 						}
 						/* Half-selected cells for eNVM */
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
+						if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
 							if (!static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess && param->writeEnergyReport) { // Cross-point
 								for (int jj = 0; jj < param->nOutput; jj++) {    // Half-selected cells in the same row
 									if (jj >= start && jj <= end) { continue; } // Skip the selected cells
@@ -1113,7 +805,7 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 									}
 								}
 							}
-						} else if (DigitalNVM *temp = dynamic_cast<DigitalNVM*>(arrayHO->cell[0][0])) { // Digital eNVM
+						} else if (arrayHO->IsDigitalNVM()) { // Digital eNVM
 							if (!static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess && param->writeEnergyReport && weightChangeBatch) { // Cross-point
 								for (int jj = 0; jj < param->nOutput; jj++) {    // Half-selected synapses in the same row
 									if (jj >= start && jj <= end) { continue; } // Skip the selected synapses
@@ -1135,60 +827,71 @@ int train_batchsize = param -> numTrainImagesPerBatch;
 							}
 						}
 					}
-					/* Calculate the average number of write pulses on the selected row */
-					#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
-					{
-						if (AnalogNVM *temp = dynamic_cast<AnalogNVM*>(arrayHO->cell[0][0])) {  // Analog eNVM
+					if (deferNeuroSimWrite) {	// Only record the row statistics, NeuroSimFlushActivity evaluates them
+						int numWritePulse = subArrayHO->numWritePulse;
+						if (arrayHO->IsAnalogNVM()) {
 							int sumNumWritePulse = 0;
 							for (int j = 0; j < param->nOutput; j++) {
-								sumNumWritePulse += abs(static_cast<AnalogNVM*>(arrayHO->cell[j][k])->numPulse);    // Note that LTD has negative pulse number
+								sumNumWritePulse += abs(arrayHO->GetNumPulse(j, k));    // Note that LTD has negative pulse number
 							}
-							subArrayHO->numWritePulse = sumNumWritePulse / param->nOutput;
-							double writeVoltageSquareSumRow = 0;
-							if (param->writeEnergyReport) {
-								if (static_cast<AnalogNVM*>(arrayHO->cell[0][0])->nonIdenticalPulse) { // Non-identical write pulse scheme
-									for (int j = 0; j < param->nOutput; j++) {
-										writeVoltageSquareSumRow += static_cast<AnalogNVM*>(arrayHO->cell[j][k])->writeVoltageSquareSum;
-									}
-									if (sumNumWritePulse > 0) {	// Prevent division by 0
-										subArrayHO->cell.writeVoltage = sqrt(writeVoltageSquareSumRow / sumNumWritePulse);  // RMS value of write voltage in a row
-									} else {
-										subArrayHO->cell.writeVoltage = 0;
+							numWritePulse = sumNumWritePulse / param->nOutput;
+						}
+						rowNumWritePulse[k] = numWritePulse;
+						rowNumWriteOperation[k] = numWriteOperationPerRow;
+						rowNumWriteCell[k] = (double)numWriteCellPerOperation/numWriteOperationPerRow;
+					} else {
+						/* Calculate the average number of write pulses on the selected row */
+						#pragma omp critical    // Use critical here since NeuroSim class functions may update its member variables
+						{
+							if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
+								int sumNumWritePulse = 0;
+								for (int j = 0; j < param->nOutput; j++) {
+									sumNumWritePulse += abs(arrayHO->GetNumPulse(j, k));    // Note that LTD has negative pulse number
+								}
+								subArrayHO->numWritePulse = sumNumWritePulse / param->nOutput;
+								double writeVoltageSquareSumRow = 0;
+								if (param->writeEnergyReport) {
+									if (static_cast<AnalogNVM*>(arrayHO->cell[0][0])->nonIdenticalPulse) { // Non-identical write pulse scheme
+										for (int j = 0; j < param->nOutput; j++) {
+											writeVoltageSquareSumRow += static_cast<AnalogNVM*>(arrayHO->cell[j][k])->writeVoltageSquareSum;
+										}
+										if (sumNumWritePulse > 0) {	// Prevent division by 0
+											subArrayHO->cell.writeVoltage = sqrt(writeVoltageSquareSumRow / sumNumWritePulse);  // RMS value of write voltage in a row
+										} else {
+											subArrayHO->cell.writeVoltage = 0;
+										}
 									}
+	                                else if(arrayHO->IsHybridCell())
+	                                {
+								         int sumNumWritePulse = 0;
+								         for (int j = 0; j < param->nHide; j++) {
+									           sumNumWritePulse += abs(static_cast<HybridCell*>(arrayHO->cell[j][k])->LSBcell.numPulse);    // Note that LTD has negative pulse number
+								          }
+	                                     subArrayHO->numWritePulse = sumNumWritePulse / param->nHide;
+	                                }
 								}
-                                else if(HybridCell *temp = dynamic_cast<HybridCell*>(arrayHO->cell[0][0]))
-                                {
-							         int sumNumWritePulse = 0;
-							         for (int j = 0; j < param->nHide; j++) {
-								           sumNumWritePulse += abs(static_cast<HybridCell*>(arrayHO->cell[j][k])->LSBcell.numPulse);    // Note that LTD has negative pulse number
-							          }
-                                     subArrayHO->numWritePulse = sumNumWritePulse / param->nHide;
-                                }
 							}
+							numWriteCellPerOperation = (double)numWriteCellPerOperation/numWriteOperationPerRow;
+							sumNeuroSimWriteEnergy += NeuroSimSubArrayWriteEnergy(subArrayHO, numWriteOperationPerRow, numWriteCellPerOperation);
 						}
-						numWriteCellPerOperation = (double)numWriteCellPerOperation/numWriteOperationPerRow;
-						sumNeuroSimWriteEnergy += NeuroSimSubArrayWriteEnergy(subArrayHO, numWriteOperationPerRow, numWriteCellPerOperation);
 					}
 					numWriteOperation += numWriteOperationPerRow;
 				}
+				if (deferNeuroSimWrite) {
+					for (int k = 0; k < param->nHide; k++) {
+						NeuroSimDeferWrite(activityHO, rowNumWritePulse[k], rowNumWriteOperation[k], rowNumWriteCell[k], 1);
+					}
+				}
 				arrayHO->writeEnergy += sumArrayWriteEnergy;
 				subArrayHO->writeDynamicEnergy += sumNeuroSimWriteEnergy;
 				numWriteOperation = numWriteOperation / param->nHide;
 				subArrayHO->writeLatency += NeuroSimSubArrayWriteLatency(subArrayHO, numWriteOperation, sumWriteLatencyAnalogNVM);
 			} else {
-				#pragma omp parallel for
-				for (int j = 0; j < param->nOutput; j++) {
-					for (int k = 0; k < param->nHide; k++) {
-						deltaWeight2[j][k] = -param->alpha2 * s2[j] * a1[k];
-						weight2[j][k] = weight2[j][k] + deltaWeight2[j][k];
-						if (weight2[j][k] > param->maxWeight) {
-							deltaWeight2[j][k] -= weight2[j][k] - param->maxWeight;
-							weight2[j][k] = param->maxWeight;
-						} else if (weight2[j][k] < param->minWeight) {
-							deltaWeight2[j][k] += param->minWeight - weight2[j][k];
-							weight2[j][k] = param->minWeight;
-						}
-						if (param->useHardwareInTrainingFF) {
+				OuterProductUpdate(-param->alpha2, s2, a1, deltaWeight2, weight2, param->minWeight, param->maxWeight);
+				if (param->useHardwareInTrainingFF) {
+					#pragma omp parallel for
+					for (int j = 0; j < param->nOutput; j++) {
+						for (int k = 0; k < param->nHide; k++) {
 							arrayHO->WriteCell(j, k, deltaWeight2[j][k], weight2[j][k], param->maxWeight, param->minWeight, false);
 						}
 					}
@@ -1227,6 +930,378 @@ double Adam(double gradient, double learning_rate, double momentumPrev, double v
     return -learning_rate*mt/(sqrt(vt)+EPSILON);
 }
 
+/* Forward pass of training image i. The array read energy is returned instead of added to arrayIH/arrayHO,
+   so that the images of a batch can be read together and accounted in order afterwards */
+void TrainForward(int i, double *outN1, double *a1, int *da1, double *outN2, double *a2, double *arrayReadEnergyIH, double *arrayReadEnergyHO, int *numActiveRowsHO) {
+	/* First layer (input layer to the hidden layer) */
+	std::fill_n(outN1, param->nHide, 0);
+	std::fill_n(a1, param->nHide, 0);
+	if (param->useHardwareInTrainingFF) {   // Hardware
+		double sumArrayReadEnergy = 0;   // Use a temporary variable here since OpenMP does not support reduction on class member
+		double readVoltage;
+		double readVoltageMSB;  // for the hybrid cell
+		double readPulseWidth;
+		double readPulseWidthMSB;   // for the hybrid cell
+	if(arrayIH->IsAnalogNVM())
+	{
+		 readVoltage = static_cast<eNVM*>(arrayIH->cell[0][0])->readVoltage;
+		 readPulseWidth = static_cast<eNVM*>(arrayIH->cell[0][0])->readPulseWidth;
+	}
+	else if(arrayIH->IsHybridCell())
+	{
+		readVoltage = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.readVoltage;
+		readPulseWidth = static_cast<HybridCell*>(arrayIH->cell[0][0])->LSBcell.readPulseWidth; 
+		readVoltageMSB = static_cast<HybridCell*>(arrayIH->cell[0][0])->MSBcell_LTP.readVoltage;
+		readPulseWidthMSB = static_cast<HybridCell*>(arrayIH->cell[0][0])->MSBcell_LTP.readPulseWidth;     
+	}
+	#pragma omp parallel for reduction(+: sumArrayReadEnergy) copyin(randomContext)
+		for (int j=0; j<param->nHide; j++) {
+			if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
+				if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
+					sumArrayReadEnergy += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput; // All WLs open
+				}
+			} else if (arrayIH->IsDigitalNVM()) { // Digital eNVM
+				if (static_cast<eNVM*>(arrayIH->cell[0][0])->cmosAccess) {  // 1T1R
+					sumArrayReadEnergy += arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd; // Selected WL
+				} else {    // Cross-point
+					sumArrayReadEnergy += arrayIH->wireCapRow * techIH.vdd * techIH.vdd * (param->nInput - 1);  // Unselected WLs
+				}
+			} else if(arrayIH->IsHybridCell())
+			{   // multiply with 3 because we need to read PCM_LTP, PCM_LTD and 3T1C cell
+				sumArrayReadEnergy += 3*(arrayIH->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput); // All WLs open
+			} 
+
+			for (int n=0; n<param->numBitInput; n++) {
+				double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayIH->arrayRowSize;  // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
+				const int *activeRows = trainInputPlane.ActiveRows(i, n);
+				randomContext.phase = RANDOM_PHASE_TRAIN_IH + n;
+				int numActiveRows = trainInputPlane.NumActiveRows(i, n);
+				if (arrayIH->IsAnalogNVM()) {  // Analog eNVM
+					double Isum = 0;    // weighted sum current
+					double IsumMax = arrayIH->columnIsumMax[j]; // Max weighted sum current
+					double IsumMin = arrayIH->columnIsumMin[j];
+					double inputSum = arrayIH->ReferenceColumnCurrent(j, activeRows, numActiveRows);    // Weighted sum current of input vector * weight=1 column
+					Isum = arrayIH->ReadColumnCurrent(j, activeRows, numActiveRows);
+					for (int r=0; r<numActiveRows; r++) {   // rows whose nth bit of dInput[i][k] is 1
+						sumArrayReadEnergy += arrayIH->wireCapRow * readVoltage * readVoltage; // Selected BLs (1T1R) or Selected WLs (cross-point)
+					}
+					sumArrayReadEnergy += Isum * readVoltage * readPulseWidth;
+					int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(inputSum, IsumMax-IsumMin));
+					//int outputDigits = (CurrentToDigits(Isum, IsumMax)-CurrentToDigits(inputSum, IsumMax)); 
+					outN1[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);
+				}
+				else if(arrayIH->IsHybridCell())
+				{
+					double Isum_LSB = 0;              // weighted sum current of the LTP cell
+					double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
+					double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
+					double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
+					double IsumMax_MSB = 0; 
+					double IsumMin_LSB = 0;
+					double IsumMin_MSB = 0;
+					double inputSum_LSB= 0;      // Reference for LSB cell
+					for (int r=0; r<numActiveRows; r++) // rows whose nth bit of dInput[i][k] is 1
+					{
+						int k = activeRows[r];
+						Isum_LSB += arrayIH->ReadCell(j,k,"LSB");                   // the weight sum of the Jth column
+						Isum_MSB_LTP += arrayIH->ReadCell(j,k,"MSB_LTP");  
+						Isum_MSB_LTD += arrayIH->ReadCell(j,k,"MSB_LTD");  
+						inputSum_LSB += arrayIH->GetMediumCellReadCurrent(j,k);
+						sumArrayReadEnergy += arrayIH->wireCapRow * readVoltage * readVoltage; //
+						sumArrayReadEnergy += 2*arrayIH->wireCapRow * readVoltageMSB * readVoltageMSB; // 
+					}
+					for (int k=0; k<param->nInput; k++) 
+					{
+						IsumMax_LSB += arrayIH->GetMaxCellReadCurrent(j,k,"LSB");
+						IsumMax_MSB += arrayIH->GetMaxCellReadCurrent(j,k,"MSB");
+						IsumMin_LSB += arrayIH->GetMinCellReadCurrent(j,k,"LSB");
+						IsumMin_MSB += arrayIH->GetMinCellReadCurrent(j,k,"MSB");
+					}
+					sumArrayReadEnergy += Isum_LSB * readVoltage * readPulseWidth;
+					sumArrayReadEnergy += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
+					int outputDigits;
+					int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(inputSum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
+					int outputDigitsMSB = (CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB)); //minus the reference
+					outputDigits = static_cast<HybridCell*>(arrayIH->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
+					outN1[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1);  
+				} 
+				else 
+				{    // SRAM or digital eNVM
+					bool digitalNVM = false; 
+					bool parallelRead = false;
+					if(arrayIH->IsDigitalNVM())
+					{    digitalNVM = true;
+						if(static_cast<DigitalNVM*>(arrayIH->cell[0][0])->parallelRead == true) 
+						{
+							parallelRead = true;
+						}
+					}
+					if(digitalNVM && parallelRead) // parallel read-out for DigitalNVM
+					{
+						double Imax = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
+						double Imin = static_cast<DigitalNVM*>(arrayIH->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readVoltage;
+						double Isum = 0;    // weighted sum current
+						double IsumMax = 0; // Max weighted sum current
+						double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
+						int Dsum=0;
+						int DsumMax = 0;
+						int Dref = 0;
+						for (int w=0;w<param->numWeightBit;w++){
+							int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
+							for (int r=0; r<numActiveRows; r++) // accumulate the current along a column
+							{
+								int k = activeRows[r];
+								Isum += static_cast<DigitalNVM*>(arrayIH->cell[colIndex][k])->conductance*static_cast<DigitalNVM*>(arrayIH->cell[colIndex ][k])->readVoltage;
+								//inputSum += Imin;
+								// get the reference current
+								inputSum += static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayIH->cell[arrayIH->refColumnNumber][k])->readVoltage;
+							}
+							int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column // basically, this is the number of "1" in this column
+							int outputDigitsRef = (int) (inputSum/(Imax-Imin));
+							outputDigits = outputDigits-outputDigitsRef;
+
+							Dref = (int)(inputSum/Imin);
+							Isum=0;
+							inputSum=0;
+							Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
+							DsumMax += param->nInput*(int) pow(2,w); // the maximum weight that can be represented by this column
+						}
+						sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
+						outN1[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
+					}
+					else
+					{	 // Digital NVM or SRAM row-by-row readout				
+						int Dsum = arrayIH->ReadColumnDigits(j, activeRows, numActiveRows, trainInputPlane.Plane(i, n));    // rows whose nth bit of dInput[i][k] is 1
+						int DsumMax = param->nInput * ((1 << arrayIH->numCellPerSynapse) - 1);
+						int inputSum = numActiveRows * ((1 << (arrayIH->numCellPerSynapse-1)) - 1);   // get the digital weights of the dummy column as reference
+						if (arrayIH->IsDigitalNVM()) {    // Digital eNVM
+							sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
+						} 
+						else {    // SRAM
+							sumArrayReadEnergy += static_cast<SRAM*>(arrayIH->cell[0][0])->readEnergy * arrayIH->numCellPerSynapse * arrayIH->arrayRowSize;
+						}
+						outN1[j] += (double)(Dsum - inputSum) / DsumMax * pSumMaxAlgorithm;
+					}
+				}
+			}
+			a1[j] = sigmoid(outN1[j]);
+			da1[j] = round_th(a1[j]*(param->numInputLevel-1), param->Hthreshold);
+		}
+		*arrayReadEnergyIH += sumArrayReadEnergy;
+
+	} 
+	else {    // Algorithm
+		MatVec(weight1, Input[i], outN1);
+		for (int j = 0; j < param->nHide; j++) {
+			a1[j] = sigmoid(outN1[j]);
+		}
+	}
+
+	/* Second layer (hidder layer to the output layer) */
+	std::fill_n(outN2, param->nOutput, 0);
+	std::fill_n(a2, param->nOutput, 0);
+	if (param->useHardwareInTrainingFF) {   // Hardware
+	double sumArrayReadEnergy = 0;  // Use a temporary variable here since OpenMP does not support reduction on class member
+	double readVoltage;
+	double readPulseWidth;
+	double readVoltageMSB;
+	double readPulseWidthMSB;
+	if(arrayHO->IsAnalogNVM()){
+		readVoltage = static_cast<eNVM*>(arrayHO->cell[0][0])->readVoltage;
+		readPulseWidth = static_cast<eNVM*>(arrayHO->cell[0][0])->readPulseWidth;
+	}
+	else if(arrayHO->IsHybridCell())
+	{
+		readVoltage = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.readVoltage;
+		readPulseWidth = static_cast<HybridCell*>(arrayHO->cell[0][0])->LSBcell.readPulseWidth;
+		readVoltageMSB = static_cast<HybridCell*>(arrayHO->cell[0][0])->MSBcell_LTP.readVoltage;
+		readPulseWidthMSB = static_cast<HybridCell*>(arrayHO->cell[0][0])->MSBcell_LTP.readPulseWidth;             
+	}
+
+	int activeRowsHide[param->numBitInput][param->nHide];  // Rows of arrayHO driven by each bit of da1
+	int numActiveRowsHide[param->numBitInput];
+	unsigned long long activePlaneHide[param->numBitInput][(param->nHide+63)/64];	// The same rows packed as bitsets
+	*numActiveRowsHO = 0;
+	for (int n=0; n<param->numBitInput; n++) {
+		numActiveRowsHide[n] = InputPlane::FindActiveRows(da1, param->nHide, n, activeRowsHide[n]);
+		InputPlane::PackActiveRows(activeRowsHide[n], numActiveRowsHide[n], (param->nHide+63)/64, activePlaneHide[n]);
+		*numActiveRowsHO += numActiveRowsHide[n];
+	}
+
+		#pragma omp parallel for reduction(+: sumArrayReadEnergy) copyin(randomContext)
+		for (int j=0; j<param->nOutput; j++) {
+			if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
+				if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
+					sumArrayReadEnergy += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd * param->nHide; // All WLs open
+				}
+			} else if (arrayHO->IsDigitalNVM()) { // Digital eNVM
+				if (static_cast<eNVM*>(arrayHO->cell[0][0])->cmosAccess) {  // 1T1R
+					sumArrayReadEnergy += arrayHO->wireGateCapRow * techHO.vdd * techHO.vdd;    // Selected WL
+				} else {    // Cross-point
+					sumArrayReadEnergy += arrayHO->wireCapRow * techHO.vdd * techHO.vdd * (param->nHide - 1);   // Unselected WLs
+				}
+			}
+			else if(arrayHO->IsHybridCell())
+			{   // multiply with 3 because we need to read PCM_LTP, PCM_LTD and 3T1C cell
+				sumArrayReadEnergy += 3*(arrayHO->wireGateCapRow * techIH.vdd * techIH.vdd * param->nInput); // All WLs open
+			} 
+
+			for (int n=0; n<param->numBitInput; n++) {
+				double pSumMaxAlgorithm = pow(2, n) / (param->numInputLevel - 1) * arrayHO->arrayRowSize;    // Max algorithm partial weighted sum for the nth vector bit (if both max input value and max weight are 1)
+				const int *activeRows = activeRowsHide[n];
+				randomContext.phase = RANDOM_PHASE_TRAIN_HO + n;
+				int numActiveRows = numActiveRowsHide[n];
+				if (arrayHO->IsAnalogNVM()) {  // Analog eNVM
+					double Isum = 0;    // weighted sum current
+					double IsumMax = arrayHO->columnIsumMax[j]; // Max weighted sum current
+					double IsumMin = arrayHO->columnIsumMin[j];
+					double a1Sum = arrayHO->ReferenceColumnCurrent(j, activeRows, numActiveRows);    // Weighted sum current of input vector * weight=1 column
+					Isum = arrayHO->ReadColumnCurrent(j, activeRows, numActiveRows);
+					for (int r=0; r<numActiveRows; r++) {    // rows whose nth bit of da1[k] is 1
+						sumArrayReadEnergy += arrayHO->wireCapRow * readVoltage * readVoltage; // Selected BLs (1T1R) or Selected WLs (cross-point)
+					}
+					sumArrayReadEnergy += Isum * readVoltage * readPulseWidth;
+					int outputDigits = (CurrentToDigits(Isum, IsumMax-IsumMin)-CurrentToDigits(a1Sum, IsumMax-IsumMin)); //minus the reference
+					outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm);     
+				} 
+				else if( arrayHO->IsHybridCell())
+				{
+					double Isum_LSB = 0;              // weighted sum current of the LTP cell
+					double Isum_MSB_LTP = 0;    // weighted sum current of the LTP cell
+					double Isum_MSB_LTD = 0;    // weighted sum current of the LTP cell
+					double IsumMax_LSB = 0;            //the maximum weight sum current (all cells are at high conductance)
+					double IsumMin_LSB = 0;
+					double IsumMax_MSB = 0;
+					double IsumMin_MSB = 0;
+					double a1Sum_LSB= 0;      // Reference for LSB cell
+					for (int r=0; r<numActiveRows; r++) {    // rows whose nth bit of da1[k] is 1
+						int k = activeRows[r];
+						Isum_LSB += arrayHO->ReadCell(j,k,"LSB");                   // the weight sum of the Jth column
+						Isum_MSB_LTP += arrayHO->ReadCell(j,k,"MSB_LTP");  
+						Isum_MSB_LTD += arrayHO->ReadCell(j,k,"MSB_LTD");  
+						a1Sum_LSB += arrayHO->GetMediumCellReadCurrent(j,k);
+						sumArrayReadEnergy += arrayHO->wireCapRow * readVoltage * readVoltage; // Selected BLs (1T1R) or Selected WLs (cross-point)
+						sumArrayReadEnergy += 2*arrayHO->wireCapRow * readVoltageMSB * readVoltageMSB; // Selected BLs (1T1R) or Selected WLs (cross-point)
+					}
+					for (int k=0; k<param->nHide; k++) {
+						 IsumMax_LSB += arrayHO->GetMaxCellReadCurrent(j,k,"LSB");
+						 IsumMax_MSB += arrayHO->GetMaxCellReadCurrent(j,k,"MSB");
+						 IsumMin_LSB += arrayHO->GetMinCellReadCurrent(j,k,"LSB");
+						 IsumMin_MSB += arrayHO->GetMinCellReadCurrent(j,k,"MSB");
+					}
+					sumArrayReadEnergy += Isum_LSB * readVoltage * readPulseWidth;
+					sumArrayReadEnergy += (Isum_MSB_LTP + Isum_MSB_LTD) * readVoltageMSB * readPulseWidthMSB;
+					int outputDigits;
+					int outputDigitsLSB = 2*(CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB)); //minus the reference
+					//int outputDigitsLSB = CurrentToDigits(Isum_LSB, IsumMax_LSB-IsumMin_LSB)-CurrentToDigits(a1Sum_LSB, IsumMax_LSB-IsumMin_LSB); //minus the reference
+					int outputDigitsMSB = (CurrentToDigits(Isum_MSB_LTP, IsumMax_MSB-IsumMin_MSB)-CurrentToDigits(Isum_MSB_LTD, IsumMax_MSB-IsumMin_MSB)); //minus the reference
+					outputDigits = static_cast<HybridCell*>(arrayHO->cell[0][0])->significance*outputDigitsMSB+outputDigitsLSB;
+					outN2[j] += DigitsToAlgorithm(outputDigits, pSumMaxAlgorithm)/(static_cast<HybridCell*>(arrayIH->cell[0][0])->significance+1); 
+				 } 
+				else 
+				{// SRAM or digital eNVM
+					bool digitalNVM = false; 
+					bool parallelRead = false;
+					if(arrayHO->IsDigitalNVM())
+					{    digitalNVM = true;
+						if(static_cast<DigitalNVM*>(arrayHO->cell[0][0])->parallelRead == true) 
+						{
+							parallelRead = true;
+						}
+					}
+					if(digitalNVM && parallelRead)
+					{
+						double Imin = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMinConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
+						double Imax = static_cast<DigitalNVM*>(arrayHO->cell[0][0])->avgMaxConductance*static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readVoltage;
+						double Isum = 0;    // weighted sum current
+						double IsumMax = 0; // Max weighted sum current
+						double inputSum = 0;    // Weighted sum current of input vector * weight=1 column
+						int Dsum=0;
+						int DsumMax = 0;
+						int Dref = 0;
+						for (int w=0;w<param->numWeightBit;w++){
+							int colIndex = (j+1) * param->numWeightBit - (w+1);  // w=0 is the LSB
+							for (int r=0; r<numActiveRows; r++) { // accumulate the current along a column
+								int k = activeRows[r];
+								Isum += static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[colIndex][k])->readVoltage;
+								inputSum += static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->conductance*static_cast<DigitalNVM*>(arrayHO->cell[arrayHO->refColumnNumber][k])->readVoltage;                                            
+								//inputSum += Imin;
+							}
+							int outputDigits = (int) (Isum /(Imax-Imin)); // the output at the ADC of this column
+							int outputDigitsRef = (int) (inputSum/(Imax-Imin)); // basically, this is the number of "1" in this column
+							outputDigits = outputDigits-outputDigitsRef;
+
+							Dref = (int)(inputSum/Imin);
+							Isum=0;
+							inputSum=0;
+							Dsum += outputDigits*(int) pow(2,w);  // get the weight represented by the column
+							DsumMax += param->nHide*(int) pow(2,w); // the maximum weight that can be represented by this column                                        
+						}
+						sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
+						outN2[j] += (double)(Dsum - Dref*(pow(2,param->numWeightBit-1)-1)) / DsumMax * pSumMaxAlgorithm;
+					}
+					else
+					{                            
+						int Dsum = arrayHO->ReadColumnDigits(j, activeRows, numActiveRows, activePlaneHide[n]);    // rows whose nth bit of da1[k] is 1
+						int DsumMax = param->nHide * ((1 << arrayHO->numCellPerSynapse) - 1);
+						int a1Sum = numActiveRows * ((1 << (arrayHO->numCellPerSynapse-1)) - 1);    // get current of Dummy Column as reference
+						if (arrayHO->IsDigitalNVM()) {    // Digital eNVM
+							sumArrayReadEnergy += static_cast<DigitalNVM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
+						} 
+						else {
+							sumArrayReadEnergy += static_cast<SRAM*>(arrayHO->cell[0][0])->readEnergy * arrayHO->numCellPerSynapse * arrayHO->arrayRowSize;
+						}
+						outN2[j] += (double)(Dsum - a1Sum) / DsumMax * pSumMaxAlgorithm;
+					}
+				}
+			}
+			a2[j] = sigmoid(outN2[j]);
+		}
+		*arrayReadEnergyHO += sumArrayReadEnergy;
+	} else {
+		MatVec(weight2, a1, outN2);
+		for (int j = 0; j < param->nOutput; j++) {
+			a2[j] = sigmoid(outN2[j]);
+		}
+	}
+}
+
+/* NeuroSim read energy and latency of training image i, called in image order */
+void TrainReadNeuroSim(int i, int numActiveRowsHO) {
+	int numBatchReadSynapse;	// # of read synapses in a batch read operation
+	/* First layer (input layer to the hidden layer) */
+	numBatchReadSynapse = (int)ceil((double)param->nHide/param->numColMuxed);
+	if (param->deferredNeuroSim) {
+		NeuroSimDeferRead(activityIH, trainInputPlane.NumActiveRows(i), (param->nHide + numBatchReadSynapse - 1) / numBatchReadSynapse);
+	} else {
+		// Don't parallelize this loop since there may be update of member variables inside NeuroSim functions
+		for (int j=0; j<param->nHide; j+=numBatchReadSynapse) {
+			int numActiveRows = trainInputPlane.NumActiveRows(i);  // Number of selected rows for NeuroSim
+			subArrayIH->activityRowRead = (double)numActiveRows/param->nInput/param->numBitInput;
+			double readDynamicEnergy, readLatency;
+			NeuroSimReadPerformance(subArrayIH, numActiveRows, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH, &readDynamicEnergy, &readLatency);
+			subArrayIH->readDynamicEnergy += readDynamicEnergy;
+			subArrayIH->readLatency += readLatency;
+		}
+	}
+
+	/* Second layer (hidden layer to the output layer) */
+	numBatchReadSynapse = (int)ceil((double)param->nOutput/param->numColMuxed);
+	if (param->deferredNeuroSim) {
+		NeuroSimDeferRead(activityHO, numActiveRowsHO, (param->nOutput + numBatchReadSynapse - 1) / numBatchReadSynapse);
+	} else {
+		// Don't parallelize this loop since there may be update of member variables inside NeuroSim functions
+		for (int j=0; j<param->nOutput; j+=numBatchReadSynapse) {
+			int numActiveRows = numActiveRowsHO;  // Number of selected rows for NeuroSim
+			subArrayHO->activityRowRead = (double)numActiveRows/param->nHide/param->numBitInput;
+			double readDynamicEnergy, readLatency;
+			NeuroSimReadPerformance(subArrayHO, numActiveRows, adderHO, muxHO, muxDecoderHO, dffHO, subtractorHO, &readDynamicEnergy, &readLatency);
+			subArrayHO->readDynamicEnergy += readDynamicEnergy;
+			subArrayHO->readLatency += readLatency;
+		}
+	}
+}
+
 void WeightTransfer_2T1F(void)
 {
         for(int i=0; i<param->nInput;i++){
@@ -1234,6 +1309,8 @@ void WeightTransfer_2T1F(void)
             int rowLTD=0;
             for (int j=0; j<param->nHide; j++) {
                 static_cast<_2T1F*>(arrayIH->cell[j][i])->WeightTransfer( );
+                if (arrayIH->cellReadCurrent)
+                    arrayIH->UpdateReadCurrent(j, i);
                 arrayIH->transferEnergy += static_cast<_2T1F*>(arrayIH->cell[j][i])->transEnergy;
                 if(static_cast<_2T1F*>(arrayIH->cell[j][i])->transLTP)
                     rowLTP=1;
@@ -1247,6 +1324,8 @@ void WeightTransfer_2T1F(void)
             int rowLTD=0;
             for (int j=0; j<param->nOutput; j++) {
                 static_cast<_2T1F*>(arrayHO->cell[j][i])->WeightTransfer( );
+                if (arrayHO->cellReadCurrent)
+                    arrayHO->UpdateReadCurrent(j, i);
                 arrayHO->transferEnergy += static_cast<_2T1F*>(arrayHO->cell[j][i])->transEnergy;
                 if(static_cast<_2T1F*>(arrayHO->cell[j][i])->transLTP)
                     rowLTP=1;
@@ -0,0 +1,87 @@
+/*******************************************************************************
+* Copyright (c) 2015-2017
+* School of Electrical, Computer and Energy Engineering, Arizona State University
+* PI: Prof. Shimeng Yu
+* All rights reserved.
+*   
+* This source code is part of NeuroSim - a device-circuit-algorithm framework to benchmark 
+* neuro-inspired architectures with synaptic devices(e.g., SRAM and emerging non-volatile memory). 
+* Copyright of the model is maintained by the developers, and the model is distributed under 
+* the terms of the Creative Commons Attribution-NonCommercial 4.0 International Public License 
+* http://creativecommons.org/licenses/by-nc/4.0/legalcode.
+* The source code is free and you can redistribute and/or modify it
+* by providing that the following conditions are met:
+*   
+*  1) Redistributions of source code must retain the above copyright notice,
+*     this list of conditions and the following disclaimer. 
+*   
+*  2) Redistributions in binary form must reproduce the above copyright notice,
+*     this list of conditions and the following disclaimer in the documentation
+*     and/or other materials provided with the distribution.
+*   
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+* 
+* Developer list: 
+*   Pai-Yu Chen     Email: pchen72 at asu dot edu 
+*                     
+*   Xiaochen Peng   Email: xpeng15 at asu dot edu
+********************************************************************************/
+
+/* Micro-benchmark of the NeuroSim performance model: time the read energy/latency of subArrayIH and its
+   neuron peripheries, and the write energy of subArrayIH, as Train.cpp and Test.cpp call them per image.
+   Build with "make bench" and run as "./bench/formula_bench [key=value ...]" */
+
+#include <cstdio>
+#include <vector>
+#include "../Cell.h"
+#include "../Array.h"
+#include "../DataMatrix.h"
+#include "../InputPlane.h"
+#include "../formula.h"
+#include "../NeuroSim.h"
+#include "../Param.h"
+#include "../RNG.h"
+#include "../Config.h"
+#include "../Definition.h"
+#include "omp.h"
+
+#define NUM_BENCH_CALLS 20000
+
+int main(int argc, char **argv) {
+	ReadConfiguration(argc, argv);
+	randomContext.seed = param->seed;
+	omp_set_num_threads(param->numThreads);
+
+	/* Synaptic core and neuron peripheries of the default arrayIH (RealDevice) */
+	randomContext.phase = RANDOM_PHASE_SETUP_IH;
+	arrayIH->Initialization<RealDevice>(1, false, param->compactArray);
+	param->relaxArrayCellWidth = 0;
+	NeuroSimSubArrayInitialize(subArrayIH, arrayIH, inputParameterIH, techIH, cellIH);
+	NeuroSimSubArrayArea(subArrayIH);
+	NeuroSimSubArrayLeakagePower(subArrayIH);
+	NeuroSimNeuronInitialize(subArrayIH, inputParameterIH, techIH, cellIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
+	double heightNeuronIH, widthNeuronIH;
+	NeuroSimNeuronArea(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH, &heightNeuronIH, &widthNeuronIH);
+	NeuroSimNeuronLeakagePower(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
+
+	double start = omp_get_wtime();
+	double sum = 0;	// Accumulated result, compare it between builds
+	for (int i=0; i<NUM_BENCH_CALLS; i++) {
+		subArrayIH->activityRowRead = (i%100)/100.0;
+		sum += NeuroSimSubArrayReadEnergy(subArrayIH) + NeuroSimSubArrayReadLatency(subArrayIH);
+		sum += NeuroSimNeuronReadEnergy(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
+		sum += NeuroSimNeuronReadLatency(subArrayIH, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
+		sum += NeuroSimSubArrayWriteEnergy(subArrayIH, 3, 2);
+	}
+	printf("%.3f us per call set (%d call sets), result=%.6e\n", (omp_get_wtime() - start)/NUM_BENCH_CALLS*1e6, NUM_BENCH_CALLS, sum);
+	return 0;
+}
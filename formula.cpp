@@ -38,6 +38,8 @@
 
 #include <cmath>
 #include <vector>
+#include <algorithm>
+#include <functional>
 
 /* Activation function */
 double sigmoid(double x) {
@@ -89,7 +91,7 @@ double InvNonlinearWeight(double conductance, int maxNumLevel, double A, double
 }
 
 /* Get the conductance in the LTP data of measured device given a pulse position xPulse */
-double MeasuredLTP(double xPulse, int maxNumLevel, std::vector<double>& dataConductanceLTP) {
+double MeasuredLTP(double xPulse, int maxNumLevel, const std::vector<double>& dataConductanceLTP) {
 	if (xPulse > maxNumLevel) {
 		xPulse = maxNumLevel;
 	} else if (xPulse < 0) {
@@ -101,7 +103,7 @@ double MeasuredLTP(double xPulse, int maxNumLevel, std::vector<double>& dataCond
 }
 
 /* Get the conductance in the LTD data of measured device given a pulse position xPulse */
-double MeasuredLTD(double xPulse, int maxNumLevel, std::vector<double>& dataConductanceLTD) {
+double MeasuredLTD(double xPulse, int maxNumLevel, const std::vector<double>& dataConductanceLTD) {
 	if (xPulse > maxNumLevel) {
 		xPulse = maxNumLevel;
 	} else if (xPulse < 0) {
@@ -113,44 +115,28 @@ double MeasuredLTD(double xPulse, int maxNumLevel, std::vector<double>& dataCond
 }
 
 /* Inverse LTP: get the pulse position based on the LTP conductance data of measured device */
-double InvMeasuredLTP(double conductance, int maxNumLevel, std::vector<double>& dataConductanceLTP) {
-	int xLeft = -1;	// The nearest integer pulse position on the left
-	/* Sweep the data points to find out the pulse position */
-	for (int i=0; i<=maxNumLevel-1; i++) {
-		if ((dataConductanceLTP[i] - conductance) * (dataConductanceLTP[i+1] - conductance) <= 0) {
-			xLeft = i;
-			break;
-		}
-	}
-	if (xLeft == -1) {  // Pulse position not found (out of range)
-		if (conductance < dataConductanceLTP[0]) {  // Case 1: below the min LTP conductance
-			xLeft = 0;
-		} else if (conductance > dataConductanceLTP[maxNumLevel]) { // Case 2: above the max LTP conductance
-			xLeft = maxNumLevel;
-		}
-		return xLeft;
+double InvMeasuredLTP(double conductance, int maxNumLevel, const std::vector<double>& dataConductanceLTP) {
+	/* The data is monotonically increasing (checked in the MeasuredDevice constructor), so binary search for the first point >= conductance */
+	int xRight = std::lower_bound(dataConductanceLTP.begin(), dataConductanceLTP.begin() + maxNumLevel + 1, conductance) - dataConductanceLTP.begin();
+	if (xRight == 0) {	// At or below the min LTP conductance
+		return 0;
+	} else if (xRight > maxNumLevel) {	// Above the max LTP conductance
+		return maxNumLevel;
 	}
+	int xLeft = xRight - 1;	// The nearest integer pulse position on the left
 	return xLeft + (conductance - dataConductanceLTP[xLeft])/(dataConductanceLTP[xLeft+1] - dataConductanceLTP[xLeft]);
 }
 
 /* Inverse LTD: get the pulse position based on the LTD conductance data of measured device */
-double InvMeasuredLTD(double conductance, int maxNumLevel, std::vector<double>& dataConductanceLTD) {
-	int xLeft = -1;  // The nearest integer pulse position on the left
-	/* Sweep the data points to find out the pulse position */
-	for (int i=0; i<=maxNumLevel-1; i++) {
-		if ((dataConductanceLTD[i] - conductance) * (dataConductanceLTD[i+1] - conductance) <= 0) {
-			xLeft = i;
-			break;
-		}
-	}
-	if (xLeft == -1) {  // Pulse position not found (out of range)
-		if (conductance < dataConductanceLTD[maxNumLevel]) {  // Case 1: below the min LTD conductance
-			xLeft = maxNumLevel;
-		} else if (conductance > dataConductanceLTD[0]) { // Case 2: above the max LTD conductance
-			xLeft = 0;
-		}
-		return xLeft;
+double InvMeasuredLTD(double conductance, int maxNumLevel, const std::vector<double>& dataConductanceLTD) {
+	/* The data is monotonically decreasing, so binary search for the first point <= conductance */
+	int xRight = std::lower_bound(dataConductanceLTD.begin(), dataConductanceLTD.begin() + maxNumLevel + 1, conductance, std::greater<double>()) - dataConductanceLTD.begin();
+	if (xRight == 0) {	// At or above the max LTD conductance
+		return 0;
+	} else if (xRight > maxNumLevel) {	// Below the min LTD conductance
+		return maxNumLevel;
 	}
+	int xLeft = xRight - 1;	// The nearest integer pulse position on the left
 	return xLeft + (conductance - dataConductanceLTD[xLeft])/(dataConductanceLTD[xLeft+1] - dataConductanceLTD[xLeft]);
 }
 
@@ -322,3 +308,12 @@ double NonlinearConductance(double C, double NL, double Vw, double Vr, double V)
 	return C_NL;
 }
 
+/* Non-identical pulse scheme: pulse i (0 <= i < numPulse) has V = Vinit + (start+i)*Vstep and PW = PWinit + (start+i)*PWstep.
+   Returns the total pulse width and the sum of V^2 over all pulses in closed form */
+void IncrementalPulseSums(int numPulse, double start, double Vinit, double Vstep, double PWinit, double PWstep, double *sumPulseWidth, double *sumVoltageSquare) {
+	double n = numPulse;
+	double sumStep = n * start + n * (n-1) / 2;	// sum of (start+i)
+	double sumStepSquare = n * start * start + start * n * (n-1) + n * (n-1) * (2*n-1) / 6;	// sum of (start+i)^2
+	*sumPulseWidth = n * PWinit + PWstep * sumStep;
+	*sumVoltageSquare = n * Vinit * Vinit + 2 * Vinit * Vstep * sumStep + Vstep * Vstep * sumStepSquare;
+}
@@ -37,6 +37,7 @@
 ********************************************************************************/
 
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -44,8 +45,12 @@
 #include <stdlib.h>
 #include <random>
 #include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "Cell.h"
 #include "Array.h"
+#include "DataMatrix.h"
+#include "InputPlane.h"
 #include "formula.h"
 #include "NeuroSim.h"
 #include "Param.h"
@@ -53,38 +58,236 @@
 #include "Train.h"
 #include "Test.h"
 #include "Mapping.h"
+#include "RNG.h"
+#include "Config.h"
+#include "Sweep.h"
 #include "Definition.h"
 #include "omp.h"
  
 using namespace std;
 
-int main() {
-	gen.seed(0);
+#define NUM_READ_COUNTERS 6
+
+/* Read energy and latency counters that Validate() accumulates */
+void GetReadCounters(double *counter) {
+	counter[0] = arrayIH->readEnergy;
+	counter[1] = arrayHO->readEnergy;
+	counter[2] = subArrayIH->readDynamicEnergy;
+	counter[3] = subArrayHO->readDynamicEnergy;
+	counter[4] = subArrayIH->readLatency;
+	counter[5] = subArrayHO->readLatency;
+}
+
+void AddReadCounters(const double *counter) {
+	arrayIH->readEnergy += counter[0];
+	arrayHO->readEnergy += counter[1];
+	subArrayIH->readDynamicEnergy += counter[2];
+	subArrayHO->readDynamicEnergy += counter[3];
+	subArrayIH->readLatency += counter[4];
+	subArrayHO->readLatency += counter[5];
+}
+
+void FlushActivity() {
+	if (param->deferredNeuroSim) {
+		NeuroSimFlushActivity(subArrayIH, activityIH, param->nInput, adderIH, muxIH, muxDecoderIH, dffIH, subtractorIH);
+		NeuroSimFlushActivity(subArrayHO, activityHO, param->nHide, adderHO, muxHO, muxDecoderHO, dffHO, subtractorHO);
+	}
+}
+
+void TransferWeights() {
+	randomContext.phase = RANDOM_PHASE_TRANSFER;
+	if (arrayIH->IsHybridCell())
+		WeightTransfer();
+	else if(arrayIH->Is2T1F())
+		WeightTransfer_2T1F();
+}
+
+void ReportEpoch(int epoch, ofstream &outfile) {
+	if (param->sampledValidation)	// Third column: half width of the accuracy confidence interval (0: all test images)
+		outfile << epoch*param->interNumEpochs << ", " << (double)correct/numValidated*100 << ", " << validationHalfWidth*100 << endl;
+	else
+		outfile << epoch*param->interNumEpochs << ", " << (double)correct/numValidated*100 << endl;
 	
-	/* Load in MNIST data */
-	ReadTrainingDataFromFile("patch60000_train.txt", "label60000_train.txt");
-	ReadTestingDataFromFile("patch10000_test.txt", "label10000_test.txt");
+	printf("Accuracy at %d epochs is : %.2f%\n", epoch*param->interNumEpochs, (double)correct/numValidated*100);
+	if (numValidated < param->numMnistTestImages)
+		printf("\t(%d of %d test images, +/- %.2f%%)\n", numValidated, param->numMnistTestImages, validationHalfWidth*100);
+	/* Here the performance metrics of subArray also includes that of neuron peripheries (see Train.cpp and Test.cpp) */
+	printf("\tRead latency=%.4e s\n", subArrayIH->readLatency + subArrayHO->readLatency);
+	printf("\tWrite latency=%.4e s\n", subArrayIH->writeLatency + subArrayHO->writeLatency);
+	printf("\tRead energy=%.4e J\n", arrayIH->readEnergy + subArrayIH->readDynamicEnergy + arrayHO->readEnergy + subArrayHO->readDynamicEnergy);
+	printf("\tWrite energy=%.4e J\n", arrayIH->writeEnergy + subArrayIH->writeDynamicEnergy + arrayHO->writeEnergy + subArrayHO->writeDynamicEnergy);
+	if(arrayIH->IsHybridCell()){
+        printf("\tTransfer latency=%.4e s\n", subArrayIH->transferLatency + subArrayHO->transferLatency);
+        printf("\tTransfer latency=%.4e s\n", subArrayIH->transferLatency);	
+        printf("\tTransfer energy=%.4e J\n", arrayIH->transferEnergy + subArrayIH->transferDynamicEnergy + arrayHO->transferEnergy + subArrayHO->transferDynamicEnergy);
+    }
+    else if(arrayIH->Is2T1F()){
+        printf("\tTransfer latency=%.4e s\n", subArrayIH->transferLatency);	
+        printf("\tTransfer energy=%.4e J\n", arrayIH->transferEnergy + subArrayIH->transferDynamicEnergy + arrayHO->transferEnergy + subArrayHO->transferDynamicEnergy);
+     }
+    // printf("\tThe total weight update = %.4e\n", totalWeightUpdate);
+    // printf("\tThe total pulse number = %.4e\n", totalNumPulse);
+}
 
-	/* Initialization of synaptic array from input to hidden layer */
-	//arrayIH->Initialization<IdealDevice>();
-	arrayIH->Initialization<RealDevice>(); 
-	//arrayIH->Initialization<MeasuredDevice>();
-	//arrayIH->Initialization<SRAM>(param->numWeightBit);
-	//arrayIH->Initialization<DigitalNVM>(param->numWeightBit,true);
-	//arrayIH->Initialization<HybridCell>(); // the 3T1C+2PCM cell
-	//arrayIH->Initialization<_2T1F>();
+/* Asynchronous validation: a worker process validates the snapshot of each epoch while the parent trains the next one.
+   It is forked before the first OpenMP region of the parent, so that it keeps a working thread pool of numThreads threads */
+pid_t validationPid = 0;	// Validation worker (0: none)
+FILE *validationSnapshot;	// Pipe to the worker: epoch (0: stop), full validation flag and the StreamCheckpoint snapshot
+int validationResult;	// Pipe from the worker: read counters added by each validation
+bool validationPending = false;	// A snapshot was sent and its read counters are not collected yet
+
+void ValidationWorker(FILE *snapshot, int result, ofstream &outfile) {
+	int epoch;
+	bool fullValidation;
+	while (fread(&epoch, sizeof(epoch), 1, snapshot) == 1 && epoch > 0 && fread(&fullValidation, sizeof(fullValidation), 1, snapshot) == 1) {
+		StreamCheckpoint(snapshot, true);
+		if (ferror(snapshot) || feof(snapshot))
+			break;
+		randomContext.epoch = epoch;
+		double readBefore[NUM_READ_COUNTERS], readAfter[NUM_READ_COUNTERS];
+		GetReadCounters(readBefore);
+		Validate(param->sampledValidation && !fullValidation);
+		FlushActivity();
+		GetReadCounters(readAfter);
+		for (int k=0; k<NUM_READ_COUNTERS; k++)
+			readAfter[k] -= readBefore[k];
+		TransferWeights();
+		ReportEpoch(epoch, outfile);
+		fflush(stdout);
+		if (write(result, readAfter, sizeof(readAfter)) != sizeof(readAfter))
+			break;
+	}
+	outfile.close();
+	fflush(stdout);
+	_exit(0);
+}
 
+void StartValidationWorker(ofstream &outfile) {
+	int snapshotPipe[2], resultPipe[2];
+	fflush(stdout);
+	if (pipe(snapshotPipe) != 0 || pipe(resultPipe) != 0 || (validationPid = fork()) < 0) {
+		puts("Cannot start the asynchronous validation");
+		exit(-1);
+	}
+	if (validationPid == 0) {
+		close(snapshotPipe[1]);
+		close(resultPipe[0]);
+		ValidationWorker(fdopen(snapshotPipe[0], "rb"), resultPipe[1], outfile);
+	}
+	close(snapshotPipe[0]);
+	close(resultPipe[1]);
+	validationSnapshot = fdopen(snapshotPipe[1], "wb");
+	validationResult = resultPipe[0];
+}
+
+/* Wait for the validation of the previous snapshot and add its read cost to the counters */
+void CollectValidation() {
+	if (!validationPending)
+		return;
+	double counter[NUM_READ_COUNTERS];
+	if (read(validationResult, counter, sizeof(counter)) != sizeof(counter)) {
+		puts("The asynchronous validation failed");
+		exit(-1);
+	}
+	validationPending = false;
+	AddReadCounters(counter);
+}
+
+/* The snapshot includes the read cost of the previous validations, so collect them first */
+void SendValidation(int epoch, bool fullValidation) {
+	CollectValidation();
+	fwrite(&epoch, sizeof(epoch), 1, validationSnapshot);
+	fwrite(&fullValidation, sizeof(fullValidation), 1, validationSnapshot);
+	StreamCheckpoint(validationSnapshot, false);
+	if (fflush(validationSnapshot) != 0) {
+		puts("The asynchronous validation failed");
+		exit(-1);
+	}
+	validationPending = true;
+}
+
+void StopValidationWorker() {
+	if (validationPid <= 0)
+		return;
+	CollectValidation();
+	int stop = 0, status;
+	fwrite(&stop, sizeof(stop), 1, validationSnapshot);
+	fclose(validationSnapshot);
+	close(validationResult);
+	waitpid(validationPid, &status, 0);
+	validationPid = 0;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		puts("The asynchronous validation failed");
+		exit(-1);
+	}
+}
+
+/* The globals above are sized with the default Param, resize the ones the configuration changed */
+void ResizeNetwork() {
+	Input.Resize(param->numMnistTrainImages, param->nInput);
+	Output.Resize(param->numMnistTrainImages, param->nOutput);
+	testInput.Resize(param->numMnistTestImages, param->nInput);
+	testOutput.Resize(param->numMnistTestImages, param->nOutput);
+	dInput.Resize(param->numMnistTrainImages, param->nInput);
+	dTestInput.Resize(param->numMnistTestImages, param->nInput);
+	weight1.Resize(param->nHide, param->nInput);
+	weight2.Resize(param->nOutput, param->nHide);
+	deltaWeight1.Resize(param->nHide, param->nInput);
+	deltaWeight2.Resize(param->nOutput, param->nHide);
+	totalDeltaWeight1.assign(param->nHide, vector<double>(param->nInput));
+	totalDeltaWeight1_abs.assign(param->nHide, vector<double>(param->nInput));
+	totalDeltaWeight2.assign(param->nOutput, vector<double>(param->nHide));
+	totalDeltaWeight2_abs.assign(param->nOutput, vector<double>(param->nHide));
+	gradSquarePrev1.assign(param->nHide, vector<double>(param->nInput));
+	gradSquarePrev2.assign(param->nOutput, vector<double>(param->nHide));
+	gradSum1.assign(param->nHide, vector<double>(param->nInput));
+	gradSum2.assign(param->nOutput, vector<double>(param->nHide));
+	momentumPrev1.assign(param->nHide, vector<double>(param->nInput));
+	momentumPrev2.assign(param->nOutput, vector<double>(param->nHide));
+	if (arrayIH->arrayColSize != param->nHide || arrayIH->arrayRowSize != param->nInput || arrayIH->wireWidth != (int)param->arrayWireWidth)
+		arrayIH = new Array(param->nHide, param->nInput, param->arrayWireWidth);
+	if (arrayHO->arrayColSize != param->nOutput || arrayHO->arrayRowSize != param->nHide || arrayHO->wireWidth != (int)param->arrayWireWidth)
+		arrayHO = new Array(param->nOutput, param->nHide, param->arrayWireWidth);
+	activityIH = NeuroSimActivity(param->nInput * param->numBitInput);
+	activityHO = NeuroSimActivity(param->nHide * param->numBitInput);
+}
+
+/* Build the synaptic array with the cell type named by param->deviceIH or param->deviceHO */
+void InitializeArray(Array *array, const char *device) {
+	if (!strcmp(device, "IdealDevice"))
+		array->Initialization<IdealDevice>(1, false, param->compactArray);
+	else if (!strcmp(device, "RealDevice"))
+		array->Initialization<RealDevice>(1, false, param->compactArray);
+	else if (!strcmp(device, "MeasuredDevice"))
+		array->Initialization<MeasuredDevice>(1, false, param->compactArray);
+	else if (!strcmp(device, "SRAM"))
+		array->Initialization<SRAM>(param->numWeightBit);
+	else if (!strcmp(device, "DigitalNVM"))
+		array->Initialization<DigitalNVM>(param->numWeightBit,true);
+	else if (!strcmp(device, "HybridCell"))
+		array->Initialization<HybridCell>(); // the 3T1C+2PCM cell
+	else if (!strcmp(device, "_2T1F"))
+		array->Initialization<_2T1F>();
+	else {
+		printf("[Error] Unknown cell type %s\n", device);
+		exit(-1);
+	}
+}
+
+/* Build the arrays and NeuroSim cores, then train and validate (the dataset is already loaded) */
+int Simulate() {
+	ResizeNetwork();	// Again for the settings of a sweep point
+	randomContext.seed = param->seed;
+	omp_set_num_threads(param->numThreads);	// Before the arrays, which keep per-thread scratch cells
+
+	/* Initialization of synaptic array from input to hidden layer */
+	randomContext.phase = RANDOM_PHASE_SETUP_IH;
+	InitializeArray(arrayIH, param->deviceIH);
 	
 	/* Initialization of synaptic array from hidden to output layer */
-	//arrayHO->Initialization<IdealDevice>();
-	arrayHO->Initialization<RealDevice>();
-	//arrayHO->Initialization<MeasuredDevice>();
-	//arrayHO->Initialization<SRAM>(param->numWeightBit);
-	//arrayHO->Initialization<DigitalNVM>(param->numWeightBit,true);
-	//arrayHO->Initialization<HybridCell>(); // the 3T1C+2PCM cell
-	//arrayHO->Initialization<_2T1F>();
-
-    omp_set_num_threads(16);
+	randomContext.phase = RANDOM_PHASE_SETUP_HO;
+	InitializeArray(arrayHO, param->deviceHO);
+
 	/* Initialization of NeuroSim synaptic cores */
 	param->relaxArrayCellWidth = 0;
 	NeuroSimSubArrayInitialize(subArrayIH, arrayIH, inputParameterIH, techIH, cellIH);
@@ -130,42 +333,62 @@ int main() {
 	WeightInitialize();
 	if (param->useHardwareInTraining)
     	WeightToConductance();
-	srand(0);	// Pseudorandom number seed
+	srand(param->seed);	// Pseudorandom number seed
+	long long numRandomDraws = 0;	// Position in the rand() sequence, Train draws one number per training image
+	int firstValidation = 1;
+	if (param->resumeFile[0]) {
+		firstValidation = ReadCheckpoint(param->resumeFile, &numRandomDraws) + 1;
+		for (long long n=0; n<numRandomDraws; n++)
+			rand();
+		printf("Resumed from %s at %d epochs\n", param->resumeFile, (firstValidation-1)*param->interNumEpochs);
+	}
 	
 	ofstream mywriteoutfile;
-	mywriteoutfile.open("output.csv");                                                                                                            
-	for (int i=1; i<=param->totalNumEpochs/param->interNumEpochs; i++){
+	mywriteoutfile.open(param->outputFile, param->resumeFile[0]? ios::app : ios::out);
+	int numValidations = param->totalNumEpochs/param->interNumEpochs;
+	if (param->asyncValidation)
+		StartValidationWorker(mywriteoutfile);
+	for (int i=firstValidation; i<=numValidations; i++){
+		randomContext.epoch = i;
 		Train(param->numTrainImagesPerEpoch, param->interNumEpochs,param->optimization_type);
+		numRandomDraws += (long long)param->numTrainImagesPerEpoch * param->interNumEpochs;
 		if (!param->useHardwareInTraining && param->useHardwareInTestingFF) { WeightToConductance(); }
-		Validate();
-        if (HybridCell *temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0]))
-            WeightTransfer();
-        else if(_2T1F *temp = dynamic_cast<_2T1F*>(arrayIH->cell[0][0]))
-            WeightTransfer_2T1F();
-                
-		mywriteoutfile << i*param->interNumEpochs << ", " << (double)correct/param->numMnistTestImages*100 << endl;
-		
-		printf("Accuracy at %d epochs is : %.2f%\n", i*param->interNumEpochs, (double)correct/param->numMnistTestImages*100);
-		/* Here the performance metrics of subArray also includes that of neuron peripheries (see Train.cpp and Test.cpp) */
-		printf("\tRead latency=%.4e s\n", subArrayIH->readLatency + subArrayHO->readLatency);
-		printf("\tWrite latency=%.4e s\n", subArrayIH->writeLatency + subArrayHO->writeLatency);
-		printf("\tRead energy=%.4e J\n", arrayIH->readEnergy + subArrayIH->readDynamicEnergy + arrayHO->readEnergy + subArrayHO->readDynamicEnergy);
-		printf("\tWrite energy=%.4e J\n", arrayIH->writeEnergy + subArrayIH->writeDynamicEnergy + arrayHO->writeEnergy + subArrayHO->writeDynamicEnergy);
-		if(HybridCell* temp = dynamic_cast<HybridCell*>(arrayIH->cell[0][0])){
-            printf("\tTransfer latency=%.4e s\n", subArrayIH->transferLatency + subArrayHO->transferLatency);
-            printf("\tTransfer latency=%.4e s\n", subArrayIH->transferLatency);	
-            printf("\tTransfer energy=%.4e J\n", arrayIH->transferEnergy + subArrayIH->transferDynamicEnergy + arrayHO->transferEnergy + subArrayHO->transferDynamicEnergy);
-        }
-        else if(_2T1F* temp = dynamic_cast<_2T1F*>(arrayIH->cell[0][0])){
-            printf("\tTransfer latency=%.4e s\n", subArrayIH->transferLatency);	
-            printf("\tTransfer energy=%.4e J\n", arrayIH->transferEnergy + subArrayIH->transferDynamicEnergy + arrayHO->transferEnergy + subArrayHO->transferDynamicEnergy);
-         }
-        // printf("\tThe total weight update = %.4e\n", totalWeightUpdate);
-        // printf("\tThe total pulse number = %.4e\n", totalNumPulse);
+		bool fullValidation = (i == numValidations) || (param->fullValidationInterval > 0 && i % param->fullValidationInterval == 0);
+		if (param->asyncValidation) {
+			/* The worker validates, transfers and reports on its copy, the parent only transfers */
+			FlushActivity();
+			SendValidation(i, fullValidation);
+			TransferWeights();
+		} else {
+			Validate(param->sampledValidation && !fullValidation);
+			FlushActivity();
+			TransferWeights();
+			ReportEpoch(i, mywriteoutfile);
+		}
+		if (param->checkpointInterval > 0 && i % param->checkpointInterval == 0) {
+			CollectValidation();	// The checkpoint includes the read cost of the validation
+			WriteCheckpoint(param->checkpointFile, i, numRandomDraws);
+		}
 	}
+	StopValidationWorker();
 	// print the summary: 
 	printf("\n");
 	return 0;
 }
 
+int main(int argc, char **argv) {
+	ReadConfiguration(argc, argv);
+	ResizeNetwork();
+	
+	/* Load in MNIST data */
+	ReadTrainingDataFromFile("patch60000_train.txt", "label60000_train.txt");
+	ReadTestingDataFromFile("patch10000_test.txt", "label10000_test.txt");
+	trainInputPlane.Build(dInput, param->numBitInput);
+	testInputPlane.Build(dTestInput, param->numBitInput);
+
+	if (param->sweepFile[0])
+		return RunSweep(param->sweepFile, Simulate);
+	return Simulate();
+}
+
 